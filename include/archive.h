@@ -9,10 +9,15 @@
 
 #ifdef _WIN32
     #include <direct.h>
+    #include <io.h>
+    #include <fcntl.h>
+    #include <sys/types.h>
+    #include <sys/stat.h>
     #include "dirent.h"
 #else
     #include <sys/stat.h>
     #include <dirent.h>
+    #include <time.h>
 #endif
 
 #include <stdio.h>
@@ -21,8 +26,72 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include "compress.h"
+#include "hash.h"
+#include "index.h"
+#include "manifest.h"
+#include "mapping.h"
+#include "pool.h"
+#include "progress.h"
+#include "reader.h"
+#include "stats.h"
+#include "thread.h"
+#include "writer.h"
+
+typedef struct {
+    unsigned int threads;
+    bool write_index;
+    const char *manifest_output_path;
+    archive_stats *stats;
+    verbosity message_level;
+} unpack_options;
+
+// Unpack archives, filling in statistics for the run unless they are NULL. A batch with no folder is only tested.
+// Entries are hashed as they are decoded when a manifest or index is to be written.
+int unpack(const char *archive_path, const char *folder_path, const unpack_options *options);
+int unpack_batch(const char **archive_paths, size_t archive_count, const char *folder_path, const unpack_options *options);
+
+// Decode every entry of archives without writing them, failing if any entry does not match its header
+int test_archives(const char **archive_paths, size_t archive_count, const unpack_options *options);
+
+int extract(const char *archive_path, const char *folder_path, const char **filenames, size_t filename_count, verbosity message_level, archive_stats *stats);
+int index_archive(const char *archive_path, verbosity message_level);
+
+// Order files are packed in, which is the order the folder lists them in unless changed
+typedef enum {
+    PACK_ORDER_FOLDER,
+    PACK_ORDER_NAME,
+    PACK_ORDER_TYPE,
+    PACK_ORDER_MANIFEST
+} pack_order;
+
+typedef struct {
+    unsigned char compression_level;
+    compress_effort effort;
+    unsigned int threads;
+    size_t memory_budget;
+    bool write_index;
+    pack_order order;
+    const char *manifest_path;
+    archive_stats *stats;
+    verbosity message_level;
+    const char *manifest_output_path;
+} pack_options;
+
+int pack(const char *folder_path, const char *archive_path, const pack_options *options);
+
+// Compression level for repacking which keeps every entry's existing compression
+#define COMPRESSION_KEEP 254
+
+int repack(const char *source_path, const char *archive_path, const pack_options *options);
+
+// Changes which can be made to an archive in place
+typedef enum {
+    UPDATE_ADD,
+    UPDATE_REPLACE,
+    UPDATE_DELETE
+} update_type;
 
-int unpack(const char *archive_path, const char *folder_path);
-int pack(const char *folder_path, const char *archive_path);
+int update(const char *archive_path, update_type type, const char **file_paths, size_t file_count, const pack_options *options);
 
 #endif
@@ -0,0 +1,19 @@
+/*
+ * Red Archive
+ * MIT License
+ * Copyright (c) 2020 Jacob Gelling
+ */
+
+#ifndef REDARCHIVE_BENCH_H
+#define REDARCHIVE_BENCH_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "version.h"
+#include "archive.h"
+
+int main(int argc, char *argv[]);
+
+#endif
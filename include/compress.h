@@ -0,0 +1,38 @@
+/*
+ * Red Archive
+ * MIT License
+ * Copyright (c) 2020 Jacob Gelling
+ */
+
+#ifndef REDARCHIVE_COMPRESS_H
+#define REDARCHIVE_COMPRESS_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Compression level which chooses the level giving the smallest output for each file
+#define COMPRESSION_AUTO 255
+
+// Compression effort for types 2 to 6, from greedy to lazy and optimal parsing
+typedef enum {
+    COMPRESS_FAST,
+    COMPRESS_LAZY,
+    COMPRESS_OPTIMAL
+} compress_effort;
+
+// Check if data can be compressed at the given compression level
+bool compress_supported(unsigned char compression_level);
+
+// Calculate the largest compressed size of data at the given compression level
+size_t compress_bound(size_t uncompressed_size, unsigned char compression_level);
+
+// Compress data into a buffer of at least compress_bound bytes, returning 1 on success
+int compress(const unsigned char *uncompressed_data, size_t uncompressed_size, unsigned char *compressed_data, size_t *compressed_size, unsigned char compression_level, compress_effort effort);
+
+// Compress data at the level giving the smallest output, or store it if compression does not help,
+// into a buffer of at least compress_bound bytes for COMPRESSION_AUTO, returning 1 on success
+int compress_auto(const unsigned char *uncompressed_data, size_t uncompressed_size, unsigned char *compressed_data, size_t *compressed_size, unsigned char *compression_level, compress_effort effort);
+
+#endif
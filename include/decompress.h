@@ -0,0 +1,58 @@
+/*
+ * Red Archive
+ * MIT License
+ * Copyright (c) 2020 Jacob Gelling
+ */
+
+#ifndef REDARCHIVE_DECOMPRESS_H
+#define REDARCHIVE_DECOMPRESS_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    DECOMPRESS_SUCCESS,
+    DECOMPRESS_SIZE_MISMATCH,
+    DECOMPRESS_INVALID_OFFSET,
+    DECOMPRESS_UNSUPPORTED
+} decompress_result;
+
+// Decompress data of the given compression level into a buffer of exactly uncompressed_size bytes.
+// Any part of the buffer which could not be decoded is zero-filled.
+decompress_result decompress(const unsigned char *compressed_data, size_t compressed_size, unsigned char *uncompressed_data, size_t uncompressed_size, unsigned char compression_level);
+
+// Streams hold the type 2 window of up to 4096 bytes and the output waiting to be written
+#define DECOMPRESS_STREAM_WINDOW_SIZE 8192
+#define DECOMPRESS_STREAM_TOKEN_SIZE 129
+
+typedef struct {
+    unsigned char compression_level;
+    size_t uncompressed_size;
+    size_t decoded_size;
+    size_t written_size;
+    decompress_result result;
+    bool finished;
+    unsigned char flag;
+    unsigned char flag_bit;
+    bool flag_fresh;
+    unsigned char token[DECOMPRESS_STREAM_TOKEN_SIZE];
+    size_t token_size;
+    unsigned char window[DECOMPRESS_STREAM_WINDOW_SIZE];
+} decompress_stream;
+
+// Start decompressing data of the given compression level into exactly uncompressed_size bytes of output,
+// using a fixed amount of memory however large the data is
+void decompress_stream_open(decompress_stream *stream, size_t uncompressed_size, unsigned char compression_level);
+
+// Decompress a chunk of compressed data into a buffer, returning the number of bytes written to it and setting
+// input_used to the number of bytes consumed. Input is only left unconsumed once the buffer is full.
+size_t decompress_stream_update(decompress_stream *stream, const unsigned char *input, size_t input_size, size_t *input_used, unsigned char *output, size_t output_size);
+
+// Once all compressed data has been given, write the rest of the output into a buffer, returning the number of bytes
+// written, which is 0 once the output is complete and result is final. Any part which could not be decoded is
+// zero-filled, so the output is the same as from decompress.
+size_t decompress_stream_finish(decompress_stream *stream, unsigned char *output, size_t output_size);
+
+#endif
@@ -0,0 +1,29 @@
+/*
+ * Red Archive
+ * MIT License
+ * Copyright (c) 2020 Jacob Gelling
+ */
+
+#ifndef REDARCHIVE_HASH_H
+#define REDARCHIVE_HASH_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+// State of an XXH64 hash computed over data given in any number of parts
+typedef struct {
+    uint64_t accumulators[4];
+    unsigned char buffer[32];
+    size_t buffer_size;
+    uint64_t total_size;
+} hash_state;
+
+void hash_reset(hash_state *state);
+void hash_update(hash_state *state, const void *data, size_t size);
+uint64_t hash_digest(const hash_state *state);
+
+// Hash data held in memory in one call
+uint64_t hash_data(const void *data, size_t size);
+
+#endif
@@ -0,0 +1,58 @@
+/*
+ * Red Archive
+ * MIT License
+ * Copyright (c) 2020 Jacob Gelling
+ */
+
+#ifndef REDARCHIVE_INDEX_H
+#define REDARCHIVE_INDEX_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "hash.h"
+#include "mapping.h"
+#include "reader.h"
+
+// Sidecar index files are named after the archive with this suffix, for example DIRT1.ENV.idx
+#define INDEX_SUFFIX ".idx"
+
+typedef struct {
+    archive_entry *entries;
+    size_t entry_count;
+    uint64_t *hashes;
+    const char *error;
+} archive_index;
+
+// Compare filenames case-insensitively, as MS-DOS does
+int compare_filenames(const char *first, const char *second);
+
+// Index the entries of an archive held in memory by reading only their headers, returning 1 on success
+// or 0 with an error, in which case the entries before the error remain indexed
+int archive_index_build(archive_index *index, const void *data, size_t size);
+
+// Hash the uncompressed data of every entry by decompressing it, returning 1 on success.
+// Entries with unsupported compression levels are given a hash of 0
+int archive_index_hash(archive_index *index);
+
+// Write an index with hashes to the archive's sidecar file, along with the archive's size and
+// modification time so that a sidecar left behind by a changed archive can be detected
+int archive_index_save(const archive_index *index, const char *archive_path, const void *data);
+
+// Index an archive held in memory from its sidecar file if it is present and up to date, or by
+// reading its headers otherwise, returning as archive_index_build does
+int archive_index_open(archive_index *index, const char *archive_path, const void *data, size_t size);
+
+// Delete an archive's sidecar file, as must be done whenever the archive is rewritten without one
+void archive_index_remove(const char *archive_path);
+
+// Find the last entry with a filename, which is the one unpacking would leave in place
+const archive_entry *archive_index_find(const archive_index *index, const char *filename);
+
+// Free the index from memory
+void archive_index_free(archive_index *index);
+
+#endif
@@ -0,0 +1,35 @@
+/*
+ * Red Archive
+ * MIT License
+ * Copyright (c) 2020 Jacob Gelling
+ */
+
+#ifndef REDARCHIVE_MANIFEST_H
+#define REDARCHIVE_MANIFEST_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+// A JSON manifest listing the entries of archives along with the XXH64 hash of each entry's uncompressed data
+typedef struct {
+    FILE *file_pointer;
+    size_t archive_count;
+    size_t entry_count;
+} manifest_writer;
+
+// Create a manifest file, returning 1 on success
+int manifest_open(manifest_writer *manifest, const char *manifest_path);
+
+// Start listing the entries of an archive
+void manifest_begin_archive(manifest_writer *manifest, const char *archive_path);
+
+// Add an entry to the current archive, with a null hash if its compression type is unsupported
+void manifest_add(manifest_writer *manifest, const char *filename, unsigned char compression_level, uint32_t compressed_size, uint32_t uncompressed_size, uint64_t hash);
+
+// Finish listing the entries of the current archive
+void manifest_end_archive(manifest_writer *manifest);
+
+// Finish and close the manifest, returning 1 if all of it was written
+int manifest_close(manifest_writer *manifest);
+
+#endif
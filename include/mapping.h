@@ -0,0 +1,37 @@
+/*
+ * Red Archive
+ * MIT License
+ * Copyright (c) 2020 Jacob Gelling
+ */
+
+#ifndef REDARCHIVE_MAPPING_H
+#define REDARCHIVE_MAPPING_H
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+    bool mapped;
+} file_mapping;
+
+// Map a whole file into memory read-only, falling back to reading it if it cannot be mapped,
+// and advise the system whether it will be read sequentially or at random
+int map_file(file_mapping *mapping, const char *file_path, bool sequential);
+
+// Unmap or free a file previously opened with map_file
+void unmap_file(file_mapping *mapping);
+
+#endif
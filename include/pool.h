@@ -0,0 +1,44 @@
+/*
+ * Red Archive
+ * MIT License
+ * Copyright (c) 2020 Jacob Gelling
+ */
+
+#ifndef REDARCHIVE_POOL_H
+#define REDARCHIVE_POOL_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include "thread.h"
+
+// Buffers are pooled in power of two size classes from 4 KiB to 4 GiB
+#define POOL_MINIMUM_CLASS 12
+#define POOL_CLASS_COUNT 21
+
+typedef struct {
+    thread_mutex mutex;
+    void *free_buffers[POOL_CLASS_COUNT];
+    size_t allocation_count;
+    size_t allocated_size;
+    size_t request_count;
+} buffer_pool;
+
+typedef struct {
+    unsigned char *data;
+    size_t size;
+} pool_buffer;
+
+// Create an empty pool, which may be shared between threads
+void buffer_pool_init(buffer_pool *pool);
+
+// Ensure a buffer holds at least size bytes, returning its contents to the pool and taking a larger buffer if needed,
+// and returning 1 on success. Buffers start out empty, with data NULL and size 0.
+int buffer_pool_reserve(buffer_pool *pool, pool_buffer *buffer, size_t size);
+
+// Return a buffer's contents to the pool, leaving it empty
+void buffer_pool_release(buffer_pool *pool, pool_buffer *buffer);
+
+// Free every buffer held by the pool, all of which must have been released
+void buffer_pool_destroy(buffer_pool *pool);
+
+#endif
@@ -0,0 +1,56 @@
+/*
+ * Red Archive
+ * MIT License
+ * Copyright (c) 2020 Jacob Gelling
+ */
+
+#ifndef REDARCHIVE_PROGRESS_H
+#define REDARCHIVE_PROGRESS_H
+
+#ifdef _WIN32
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "stats.h"
+#include "thread.h"
+
+// How much is printed while working, from nothing but errors to a line for every entry
+typedef enum {
+    VERBOSITY_QUIET,
+    VERBOSITY_PROGRESS,
+    VERBOSITY_VERBOSE
+} verbosity;
+
+// Progress through a run, which may be shared between threads
+typedef struct {
+    FILE *file_pointer;
+    verbosity level;
+    const char *action;
+    bool terminal;
+    bool line_shown;
+    thread_mutex mutex;
+    uint64_t entry_count;
+    uint64_t byte_count;
+    double start_time;
+    double print_time;
+} progress_report;
+
+// Start reporting progress of an action, such as "Unpacked", to a file
+void progress_begin(progress_report *report, FILE *file_pointer, verbosity level, const char *action);
+
+// Print a message if the report's level is at least the given level
+void progress_message(progress_report *report, verbosity level, const char *format, ...);
+
+// Count a finished entry of the given size, updating the progress line at most ten times a second on a terminal
+void progress_advance(progress_report *report, uint64_t byte_count);
+
+// Print the final count, size and rate
+void progress_end(progress_report *report);
+
+#endif
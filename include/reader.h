@@ -0,0 +1,49 @@
+/*
+ * Red Archive
+ * MIT License
+ * Copyright (c) 2020 Jacob Gelling
+ */
+
+#ifndef REDARCHIVE_READER_H
+#define REDARCHIVE_READER_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "decompress.h"
+
+// Set filename size to length of 8.3 filename with null-terminator
+#define FILENAME_SIZE 13
+
+// Set header size to compressed size, uncompressed size and compression level
+#define HEADER_SIZE 9
+
+typedef struct {
+    char filename[FILENAME_SIZE];
+    uint32_t compressed_size;
+    uint32_t uncompressed_size;
+    unsigned char compression_level;
+    const unsigned char *data;
+} archive_entry;
+
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+    size_t position;
+    const char *error;
+} archive_reader;
+
+// Check if a filename is a valid 8.3 filename
+bool valid_filename(const char *filename);
+
+// Open an archive held in memory, which must remain valid while the reader is used
+void archive_reader_open(archive_reader *reader, const void *data, size_t size);
+
+// Read the next entry, returning 1 if an entry was read, 0 at the end of the archive or -1 on error
+int archive_reader_next(archive_reader *reader, archive_entry *entry);
+
+// Extract an entry into a buffer of at least uncompressed_size bytes
+decompress_result archive_extract(const archive_entry *entry, void *buffer, size_t buffer_size);
+
+#endif
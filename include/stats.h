@@ -0,0 +1,103 @@
+/*
+ * Red Archive
+ * MIT License
+ * Copyright (c) 2020 Jacob Gelling
+ */
+
+#ifndef REDARCHIVE_STATS_H
+#define REDARCHIVE_STATS_H
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <time.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Phases of unpacking or packing which are timed separately
+typedef enum {
+    STATS_SCAN,
+    STATS_READ,
+    STATS_DECOMPRESS,
+    STATS_COMPRESS,
+    STATS_HASH,
+    STATS_WRITE,
+    STATS_PHASE_COUNT
+} stats_phase;
+
+// File operations which are counted, each of which is at least one system call
+typedef enum {
+    STATS_OPEN,
+    STATS_MAP,
+    STATS_READ_CALL,
+    STATS_WRITE_CALL,
+    STATS_CALL_COUNT
+} stats_call;
+
+// Entries are counted by compression type 0 to 6, with unsupported types counted together after them
+#define STATS_TYPE_COUNT 8
+
+// Statistics for one run, with phase times summed over every thread which took part
+typedef struct {
+    double wall_time[STATS_PHASE_COUNT];
+    double cpu_time[STATS_PHASE_COUNT];
+    uint64_t entry_count[STATS_TYPE_COUNT];
+    uint64_t bytes_in[STATS_TYPE_COUNT];
+    uint64_t bytes_out[STATS_TYPE_COUNT];
+    uint64_t call_count[STATS_CALL_COUNT];
+    size_t peak_buffer_size;
+    uint64_t buffer_allocation_count;
+    uint64_t buffer_request_count;
+    double total_wall_time;
+    double total_cpu_time;
+} archive_stats;
+
+typedef struct {
+    double wall_time;
+    double cpu_time;
+} stats_timer;
+
+// Seconds since an arbitrary point, for measuring elapsed time
+double stats_wall_time(void);
+
+// Seconds of CPU time used by the calling thread, or by the whole process
+double stats_thread_time(void);
+double stats_process_time(void);
+
+// Clear all statistics and start timing a run
+void stats_begin(archive_stats *stats);
+
+// Stop timing a run
+void stats_end(archive_stats *stats);
+
+// Start timing a phase. Every function taking statistics does nothing if they are NULL.
+void stats_start(const archive_stats *stats, stats_timer *timer);
+
+// Add the time since a phase was started to its totals
+void stats_stop(archive_stats *stats, stats_phase phase, const stats_timer *timer);
+
+// Count an entry of the given compression type read as bytes_in bytes and written as bytes_out bytes
+void stats_entry(archive_stats *stats, unsigned char compression_level, uint64_t bytes_in, uint64_t bytes_out);
+
+// Count file operations
+void stats_calls(archive_stats *stats, stats_call call, uint64_t count);
+
+// Record a buffer size, keeping the largest
+void stats_buffer(archive_stats *stats, size_t size);
+
+// Record the memory a buffer pool allocated, and count its allocations and the requests made of it,
+// which stop growing once the pool holds a buffer for every request
+void stats_pool(archive_stats *stats, size_t allocated_size, size_t allocation_count, size_t request_count);
+
+// Add statistics gathered by another thread, without their run times
+void stats_merge(archive_stats *stats, const archive_stats *other);
+
+// Print statistics as text or as one JSON object
+void stats_print(const archive_stats *stats, FILE *file_pointer);
+void stats_print_json(const archive_stats *stats, FILE *file_pointer);
+
+#endif
@@ -0,0 +1,46 @@
+/*
+ * Red Archive
+ * MIT License
+ * Copyright (c) 2020 Jacob Gelling
+ */
+
+#ifndef REDARCHIVE_THREAD_H
+#define REDARCHIVE_THREAD_H
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <pthread.h>
+#endif
+
+#include <stdlib.h>
+
+#ifdef _WIN32
+    typedef HANDLE thread_handle;
+    typedef CRITICAL_SECTION thread_mutex;
+    typedef CONDITION_VARIABLE thread_condition;
+#else
+    typedef pthread_t thread_handle;
+    typedef pthread_mutex_t thread_mutex;
+    typedef pthread_cond_t thread_condition;
+#endif
+
+typedef void (*thread_function)(void *argument);
+
+// Start a thread running the given function, returning 1 on success
+int thread_create(thread_handle *thread, thread_function function, void *argument);
+
+// Wait for a thread to finish
+void thread_join(thread_handle thread);
+
+void mutex_init(thread_mutex *mutex);
+void mutex_lock(thread_mutex *mutex);
+void mutex_unlock(thread_mutex *mutex);
+void mutex_destroy(thread_mutex *mutex);
+
+void condition_init(thread_condition *condition);
+void condition_wait(thread_condition *condition, thread_mutex *mutex);
+void condition_broadcast(thread_condition *condition);
+void condition_destroy(thread_condition *condition);
+
+#endif
@@ -0,0 +1,38 @@
+/*
+ * Red Archive
+ * MIT License
+ * Copyright (c) 2020 Jacob Gelling
+ */
+
+#ifndef REDARCHIVE_WRITER_H
+#define REDARCHIVE_WRITER_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "reader.h"
+#include "compress.h"
+
+typedef struct {
+    unsigned char *data;
+    size_t size;
+    size_t capacity;
+    compress_effort effort;
+} archive_writer;
+
+// Write an entry's filename and header into a buffer of at least FILENAME_SIZE + HEADER_SIZE bytes, returning its length
+size_t write_entry_header(unsigned char *buffer, const char *filename, uint32_t compressed_size, uint32_t uncompressed_size, unsigned char compression_level);
+
+// Create an empty archive in memory, compressing with lazy effort unless changed
+void archive_writer_open(archive_writer *writer);
+
+// Add a file held in memory to the archive at the given compression level or COMPRESSION_AUTO, returning 1 on success
+int archive_writer_add(archive_writer *writer, const char *filename, const void *data, size_t size, unsigned char compression_level);
+
+// Write the end of file byte, after which data and size hold the complete archive
+int archive_writer_finish(archive_writer *writer);
+
+// Free the archive from memory
+void archive_writer_close(archive_writer *writer);
+
+#endif
@@ -6,9 +6,6 @@
 
 #include "archive.h"
 
-// Set filename size to length of 8.3 filename with null-terminator
-#define FILENAME_SIZE 13
-
 static inline void make_folder(const char *folder_path)  {
     #ifdef _WIN32
         _mkdir(folder_path);
@@ -17,24 +14,6 @@ static inline void make_folder(const char *folder_path)  {
     #endif
 }
 
-static bool valid_filename_character(const char character) {
-    // Check if a valid MS-DOS filename character
-    if (
-        (character >= 36 && character <= 41)  || // !-)
-        (character >= 48 && character <= 57)  || // 0-9
-        (character >= 64 && character <= 90)  || // @-Z
-        (character >= 94 && character <= 123) || // ^-{
-        character == 33  || // !
-        character == 45  || // -
-        character == 46  || // .
-        character == 125 || // }
-        character == 126    // ~
-    ) {
-        return true;
-    }
-    return false;
-}
-
 static char *make_file_path(const char *folder_path, const char *filename) {
     char *file_path = malloc(strlen(filename) + strlen(folder_path) + 2);
     strcpy(file_path, folder_path);
@@ -43,357 +22,866 @@ static char *make_file_path(const char *folder_path, const char *filename) {
     return file_path;
 }
 
-static size_t get_file_size(FILE *file_pointer) {
-    fseek(file_pointer, 0, SEEK_END);
-    const size_t file_size = ftell(file_pointer);
-    fseek(file_pointer, 0, SEEK_SET);
-    return file_size;
+// Paths of files being extracted are built on the stack unless they are longer than this
+#define PATH_BUFFER_SIZE 1024
+
+static FILE *create_file(const char *folder_path, const char *filename) {
+    // Build file path without allocating memory
+    char path_buffer[PATH_BUFFER_SIZE];
+    const size_t path_size = strlen(folder_path) + strlen(filename) + 2;
+    char *file_path = path_size <= PATH_BUFFER_SIZE ? path_buffer : malloc(path_size);
+    if (file_path == NULL) {
+        return NULL;
+    }
+    strcpy(file_path, folder_path);
+    strcat(file_path, "/");
+    strcat(file_path, filename);
+
+    // Open file
+    FILE *file_pointer = fopen(file_path, "wb");
+    if (file_path != path_buffer) {
+        free(file_path);
+    }
+    return file_pointer;
 }
 
-int unpack(const char *archive_path, const char *folder_path) {
-    // Open archive
-    FILE *archive_pointer = NULL;
-    if ((archive_pointer = fopen(archive_path, "rb")) == NULL) {
-        fprintf(stderr, "Error opening archive %s\n", archive_path);
+static int write_file(const char *folder_path, const char *filename, const void *data, const size_t size, archive_stats *stats) {
+    // Open file
+    stats_timer timer;
+    stats_start(stats, &timer);
+    FILE *file_pointer = create_file(folder_path, filename);
+    stats_calls(stats, STATS_OPEN, 1);
+    if (file_pointer == NULL) {
+        stats_stop(stats, STATS_WRITE, &timer);
+        fprintf(stderr, "Error creating file\n");
         return 0;
     }
 
-    // Create folder
-    make_folder(folder_path);
+    // Write data to file
+    const int write_status = size == 0 || fwrite(data, size, 1, file_pointer) == 1;
+    stats_calls(stats, STATS_WRITE_CALL, size > 0);
+    fclose(file_pointer);
+    stats_stop(stats, STATS_WRITE, &timer);
+    if (!write_status) {
+        fprintf(stderr, "Error writing file data\n");
+        return 0;
+    }
+    return 1;
+}
 
-    // Unpack all files
-    while (1) {
-        // Get position in file
-        size_t position = ftell(archive_pointer);
+// Entries larger than this are decompressed through a fixed buffer rather than all at once
+#define STREAM_ENTRY_SIZE (4 << 20)
+#define STREAM_BUFFER_SIZE 65536
 
-        // Read filename
-        char filename_buffer[FILENAME_SIZE];
-        const size_t filename_read = fread(filename_buffer, 1, FILENAME_SIZE, archive_pointer);
+static void report_result(const archive_entry *entry, const decompress_result result) {
+    // Print warning if output does not match expected size
+    if (result == DECOMPRESS_INVALID_OFFSET) {
+        fprintf(stderr, "'%s' has invalid offset during decompression\n", entry->filename);
+    }
+    if (result != DECOMPRESS_SUCCESS) {
+        fprintf(stderr, "'%s' does not match expected size\n", entry->filename);
+    }
+}
 
-        // Fail if no filename read
-        if (filename_read == 0) {
-            fclose(archive_pointer);
-            fprintf(stderr, "Could not read filename in archive %s\n", archive_path);
-            return 0;
-        }
+static int extract_entry_stream(const archive_entry *entry, const char *folder_path, buffer_pool *pool, archive_stats *stats, hash_state *hash) {
+    // Open file
+    stats_timer timer;
+    stats_start(stats, &timer);
+    FILE *file_pointer = create_file(folder_path, entry->filename);
+    stats_calls(stats, STATS_OPEN, 1);
+    stats_stop(stats, STATS_WRITE, &timer);
+    if (file_pointer == NULL) {
+        fprintf(stderr, "Error creating file\n");
+        return 0;
+    }
 
-        // Finish unpacking if end of file byte found
-        if (filename_read == 1 && filename_buffer[0] == '\0') {
+    // Take stream and output buffer from the pool
+    pool_buffer stream_buffer = {NULL, 0};
+    if (!buffer_pool_reserve(pool, &stream_buffer, sizeof(decompress_stream) + STREAM_BUFFER_SIZE)) {
+        fclose(file_pointer);
+        fprintf(stderr, "Could not allocate memory for %s\n", entry->filename);
+        return 0;
+    }
+    decompress_stream *stream = (decompress_stream *) stream_buffer.data;
+    unsigned char *buffer = &stream_buffer.data[sizeof(decompress_stream)];
+    decompress_stream_open(stream, entry->uncompressed_size, entry->compression_level);
+
+    // Decompress data a buffer at a time, writing each to file
+    size_t compressed_pointer = 0;
+    int write_status = 1;
+    while (write_status) {
+        size_t output_size;
+        stats_start(stats, &timer);
+        if (compressed_pointer < entry->compressed_size) {
+            size_t input_used;
+            output_size = decompress_stream_update(stream, &entry->data[compressed_pointer], entry->compressed_size - compressed_pointer, &input_used, buffer, STREAM_BUFFER_SIZE);
+            compressed_pointer += input_used;
+        } else if ((output_size = decompress_stream_finish(stream, buffer, STREAM_BUFFER_SIZE)) == 0) {
+            stats_stop(stats, STATS_DECOMPRESS, &timer);
             break;
         }
+        stats_stop(stats, STATS_DECOMPRESS, &timer);
 
-        // Ensure filename is valid
-        const size_t filename_last_i = filename_read - 1;
-        for (size_t i = 0; i < filename_read; i++) {
-            // Break if null-terminator found
-            if (i > 0 && filename_buffer[i] == 0) {
+        // Hash each buffer while it is still in cache
+        if (hash != NULL) {
+            stats_start(stats, &timer);
+            hash_update(hash, buffer, output_size);
+            stats_stop(stats, STATS_HASH, &timer);
+        }
+        stats_start(stats, &timer);
+        write_status = output_size == 0 || fwrite(buffer, output_size, 1, file_pointer) == 1;
+        stats_calls(stats, STATS_WRITE_CALL, output_size > 0);
+        stats_stop(stats, STATS_WRITE, &timer);
+    }
+    stats_start(stats, &timer);
+    write_status = fclose(file_pointer) == 0 && write_status;
+    stats_stop(stats, STATS_WRITE, &timer);
+    report_result(entry, stream->result);
+    buffer_pool_release(pool, &stream_buffer);
+    if (!write_status) {
+        fprintf(stderr, "Error writing file data\n");
+        return 0;
+    }
+    return 1;
+}
+
+static void hash_output(const void *data, const size_t size, archive_stats *stats, uint64_t *hash) {
+    // Hash data which has just been decompressed or is about to be written, unless no hash is wanted
+    if (hash == NULL) {
+        return;
+    }
+    stats_timer timer;
+    stats_start(stats, &timer);
+    *hash = hash_data(data, size);
+    stats_stop(stats, STATS_HASH, &timer);
+}
+
+static int extract_entry(const archive_entry *entry, const char *folder_path, buffer_pool *pool, pool_buffer *buffer, archive_stats *stats, uint64_t *hash) {
+    // Write uncompressed data straight from the archive to file
+    if (entry->compression_level == 0) {
+        // Print warning if compressed size does not match uncompressed size
+        if (entry->compressed_size != entry->uncompressed_size) {
+            fprintf(stderr, "Compressed size does not match uncompressed size\n");
+        }
+        stats_entry(stats, 0, entry->compressed_size, entry->compressed_size);
+        hash_output(entry->data, entry->compressed_size, stats, hash);
+        return write_file(folder_path, entry->filename, entry->data, entry->compressed_size, stats);
+    }
+
+    // Skip unsupported compression levels, which are given a hash of 0 as in an index
+    if (entry->compression_level > 6) {
+        stats_entry(stats, entry->compression_level, entry->compressed_size, 0);
+        if (hash != NULL) {
+            *hash = 0;
+        }
+        fprintf(stderr, "Unsupported run and offset length\n");
+        return 1;
+    }
+    stats_entry(stats, entry->compression_level, entry->compressed_size, entry->uncompressed_size);
+
+    // Keep memory bounded for large entries
+    if (entry->uncompressed_size > STREAM_ENTRY_SIZE) {
+        hash_state stream_hash;
+        hash_reset(&stream_hash);
+        const int extract_status = extract_entry_stream(entry, folder_path, pool, stats, hash != NULL ? &stream_hash : NULL);
+        if (hash != NULL) {
+            *hash = hash_digest(&stream_hash);
+        }
+        return extract_status;
+    }
+
+    // Grow decompression buffer, which is reused between entries
+    if (!buffer_pool_reserve(pool, buffer, entry->uncompressed_size)) {
+        fprintf(stderr, "Could not allocate memory for %s\n", entry->filename);
+        return 0;
+    }
+
+    // Decompress data
+    stats_timer timer;
+    stats_start(stats, &timer);
+    const decompress_result result = archive_extract(entry, buffer->data, buffer->size);
+    stats_stop(stats, STATS_DECOMPRESS, &timer);
+    report_result(entry, result);
+    hash_output(buffer->data, entry->uncompressed_size, stats, hash);
+
+    // Copy from memory to file
+    return write_file(folder_path, entry->filename, buffer->data, entry->uncompressed_size, stats);
+}
+
+static int test_entry(const archive_entry *entry, buffer_pool *pool, pool_buffer *buffer, archive_stats *stats, decompress_result *result, uint64_t *hash) {
+    // Stored entries only need their sizes compared, and unsupported types cannot be checked
+    stats_entry(stats, entry->compression_level, entry->compressed_size, entry->compression_level <= 6 ? entry->uncompressed_size : 0);
+    if (entry->compression_level == 0) {
+        *result = entry->compressed_size == entry->uncompressed_size ? DECOMPRESS_SUCCESS : DECOMPRESS_SIZE_MISMATCH;
+        hash_output(entry->data, entry->compressed_size, stats, hash);
+        return 1;
+    }
+    if (entry->compression_level > 6) {
+        *result = DECOMPRESS_UNSUPPORTED;
+        if (hash != NULL) {
+            *hash = 0;
+        }
+        return 1;
+    }
+
+    // Decode into a scratch buffer, a stream buffer at a time for large entries
+    const size_t buffer_size = entry->uncompressed_size > STREAM_ENTRY_SIZE ? sizeof(decompress_stream) + STREAM_BUFFER_SIZE : entry->uncompressed_size;
+    if (!buffer_pool_reserve(pool, buffer, buffer_size)) {
+        fprintf(stderr, "Could not allocate memory for %s\n", entry->filename);
+        return 0;
+    }
+    stats_timer timer;
+    stats_start(stats, &timer);
+    if (entry->uncompressed_size > STREAM_ENTRY_SIZE) {
+        decompress_stream *stream = (decompress_stream *) buffer->data;
+        unsigned char *output = &buffer->data[sizeof(decompress_stream)];
+        decompress_stream_open(stream, entry->uncompressed_size, entry->compression_level);
+        hash_state stream_hash;
+        hash_reset(&stream_hash);
+        size_t compressed_pointer = 0;
+        while (true) {
+            size_t output_size;
+            if (compressed_pointer < entry->compressed_size) {
+                size_t input_used;
+                output_size = decompress_stream_update(stream, &entry->data[compressed_pointer], entry->compressed_size - compressed_pointer, &input_used, output, STREAM_BUFFER_SIZE);
+                compressed_pointer += input_used;
+            } else if ((output_size = decompress_stream_finish(stream, output, STREAM_BUFFER_SIZE)) == 0) {
                 break;
-            // Fail if invalid character found or string is unterminated
-            } else if (!valid_filename_character(filename_buffer[i]) || (i == filename_last_i && filename_buffer[i] != 0)) {
-                fclose(archive_pointer);
-                fprintf(stderr, "Invalid filename in archive %s\n", archive_path);
-                return 0;
+            }
+            if (hash != NULL) {
+                hash_update(&stream_hash, output, output_size);
             }
         }
+        *result = stream->result;
+        if (hash != NULL) {
+            *hash = hash_digest(&stream_hash);
+        }
+    } else {
+        *result = archive_extract(entry, buffer->data, buffer->size);
+    }
+    stats_stop(stats, STATS_DECOMPRESS, &timer);
+    if (entry->uncompressed_size <= STREAM_ENTRY_SIZE) {
+        hash_output(buffer->data, entry->uncompressed_size, stats, hash);
+    }
+    return 1;
+}
 
-        // Create filename string from buffer
-        const char *filename = &filename_buffer[0];
-
-        // Print current filename
-        printf("Extracting %s from %s...\n", filename, archive_path);
+static int compare_entries(const void *first, const void *second) {
+    // Sort entries by filename, then by position in the archive
+    const archive_entry *first_entry = *(const archive_entry **) first;
+    const archive_entry *second_entry = *(const archive_entry **) second;
+    const int difference = compare_filenames(first_entry->filename, second_entry->filename);
+    if (difference != 0) {
+        return difference;
+    }
+    return (first_entry > second_entry) - (first_entry < second_entry);
+}
 
-        // Seek to end of filename
-        size_t seek = fseek(archive_pointer, position + strlen(filename) + 1, SEEK_SET);
+static int link_duplicates(const archive_entry *entries, const size_t entry_count, size_t *next_duplicate, bool *duplicate) {
+    // Sort entries by filename
+    const archive_entry **sorted_entries = malloc(entry_count * sizeof(archive_entry *));
+    if (sorted_entries == NULL && entry_count > 0) {
+        return 0;
+    }
+    for (size_t i = 0; i < entry_count; i++) {
+        sorted_entries[i] = &entries[i];
+        next_duplicate[i] = SIZE_MAX;
+        duplicate[i] = false;
+    }
+    qsort(sorted_entries, entry_count, sizeof(archive_entry *), compare_entries);
 
-        // Read compressed size
-        uint32_t compressed_size;
-        if (fread(&compressed_size, 4, 1, archive_pointer) != 1) {
-            fclose(archive_pointer);
-            fprintf(stderr, "Could not read compressed size\n");
-            return 0;
+    // Link each entry to the next entry which would overwrite its file
+    for (size_t i = 1; i < entry_count; i++) {
+        if (compare_filenames(sorted_entries[i - 1]->filename, sorted_entries[i]->filename) == 0) {
+            next_duplicate[sorted_entries[i - 1] - entries] = sorted_entries[i] - entries;
+            duplicate[sorted_entries[i] - entries] = true;
         }
+    }
+    free(sorted_entries);
+    return 1;
+}
 
-        // Read uncompressed size
-        uint32_t uncompressed_size;
-        if (fread(&uncompressed_size, 4, 1, archive_pointer) != 1) {
-            fclose(archive_pointer);
-            fprintf(stderr, "Could not read uncompressed size\n");
-            return 0;
+// An archive being unpacked by a pool of threads, with entries sharing a filename linked in archive order,
+// or only tested if it has no folder. Entries are hashed as they are decoded if it has hashes.
+typedef struct {
+    const char *archive_path;
+    char *folder_path;
+    file_mapping mapping;
+    archive_index index;
+    size_t *next_duplicate;
+    bool *duplicate;
+    uint64_t *hashes;
+} unpack_job;
+
+typedef struct {
+    unpack_job *jobs;
+    size_t job_count;
+    thread_mutex mutex;
+    size_t next_job;
+    size_t next_entry;
+    buffer_pool buffers;
+    progress_report *progress;
+    archive_stats *stats;
+    size_t mismatch_count;
+    bool failed;
+} unpack_pool;
+
+static int open_job(unpack_job *job, const char *archive_path, const char *folder_path, const bool hash_entries, archive_stats *stats) {
+    memset(job, 0, sizeof(unpack_job));
+    job->archive_path = archive_path;
+
+    // Map archive into memory
+    stats_timer timer;
+    stats_start(stats, &timer);
+    const int map_status = map_file(&job->mapping, archive_path, true);
+    stats_calls(stats, STATS_MAP, 1);
+    stats_stop(stats, STATS_READ, &timer);
+    if (!map_status) {
+        fprintf(stderr, "Error opening archive %s\n", archive_path);
+        return 0;
+    }
+
+    // Create folder
+    if (folder_path != NULL) {
+        job->folder_path = malloc(strlen(folder_path) + 1);
+        strcpy(job->folder_path, folder_path);
+        make_folder(folder_path);
+    }
+
+    // Index all entries, keeping those before any error to be extracted before it is reported
+    stats_start(stats, &timer);
+    archive_index_open(&job->index, archive_path, job->mapping.data, job->mapping.size);
+    stats_stop(stats, STATS_SCAN, &timer);
+
+    // Find entries with the same filename, which must be extracted in order by one thread
+    const size_t entry_count = job->index.entry_count;
+    job->next_duplicate = malloc(entry_count * sizeof(size_t));
+    job->duplicate = malloc(entry_count * sizeof(bool));
+    job->hashes = hash_entries ? malloc(entry_count * sizeof(uint64_t)) : NULL;
+    if (entry_count > 0 && (job->next_duplicate == NULL || job->duplicate == NULL || (hash_entries && job->hashes == NULL)
+        || !link_duplicates(job->index.entries, entry_count, job->next_duplicate, job->duplicate))) {
+        job->index.entry_count = 0;
+        fprintf(stderr, "Could not allocate memory for %s\n", archive_path);
+        return 0;
+    }
+    return 1;
+}
+
+static void close_job(unpack_job *job) {
+    archive_index_free(&job->index);
+    if (job->mapping.data != NULL) {
+        unmap_file(&job->mapping);
+    }
+    free(job->folder_path);
+    free(job->next_duplicate);
+    free(job->duplicate);
+    free(job->hashes);
+}
+
+static void unpack_worker(void *argument) {
+    unpack_pool *pool = argument;
+    pool_buffer buffer = {NULL, 0};
+
+    // Gather statistics apart from other threads, adding them to the pool's when done
+    archive_stats worker_stats;
+    archive_stats *stats = pool->stats != NULL ? &worker_stats : NULL;
+    if (stats != NULL) {
+        memset(stats, 0, sizeof(archive_stats));
+    }
+
+    while (1) {
+        // Claim next entry from any archive, skipping those extracted after an earlier entry with the same filename
+        mutex_lock(&pool->mutex);
+        unpack_job *job = NULL;
+        while (!pool->failed && pool->next_job < pool->job_count) {
+            job = &pool->jobs[pool->next_job];
+            if (pool->next_entry == job->index.entry_count) {
+                pool->next_job++;
+                pool->next_entry = 0;
+            } else if (job->duplicate[pool->next_entry]) {
+                pool->next_entry++;
+            } else {
+                break;
+            }
+            job = NULL;
+        }
+        if (job == NULL) {
+            mutex_unlock(&pool->mutex);
+            break;
         }
+        size_t entry_index = pool->next_entry++;
+        mutex_unlock(&pool->mutex);
+
+        // Extract entry followed by any entries which overwrite it, in archive order
+        for (; entry_index != SIZE_MAX; entry_index = job->next_duplicate[entry_index]) {
+            const archive_entry *entry = &job->index.entries[entry_index];
+            progress_message(pool->progress, VERBOSITY_VERBOSE, job->folder_path != NULL ? "Extracting %s from %s...\n" : "Testing %s in %s...\n", entry->filename, job->archive_path);
+            decompress_result result = DECOMPRESS_SUCCESS;
+            uint64_t *hash = job->hashes != NULL ? &job->hashes[entry_index] : NULL;
+            const int extract_status = job->folder_path != NULL
+                ? extract_entry(entry, job->folder_path, &pool->buffers, &buffer, stats, hash)
+                : test_entry(entry, &pool->buffers, &buffer, stats, &result, hash);
+            if (!extract_status) {
+                mutex_lock(&pool->mutex);
+                pool->failed = true;
+                mutex_unlock(&pool->mutex);
+                break;
+            }
 
-        // Read compression level
-        char compression_level;
-        if (fread(&compression_level, 1, 1, archive_pointer) != 1) {
-            fclose(archive_pointer);
-            fprintf(stderr, "Could not read compression level\n");
-            return 0;
+            // Count tested entries which would not be extracted as their header describes
+            if (result != DECOMPRESS_SUCCESS) {
+                fprintf(stderr, "'%s' in archive %s %s\n", entry->filename, job->archive_path,
+                    result == DECOMPRESS_INVALID_OFFSET ? "has invalid offset" : result == DECOMPRESS_UNSUPPORTED ? "has unsupported compression type" : "does not match expected size");
+                mutex_lock(&pool->mutex);
+                pool->mismatch_count++;
+                mutex_unlock(&pool->mutex);
+            }
+            progress_advance(pool->progress, entry->uncompressed_size);
         }
+    }
 
-        // Get position in file
-        position = ftell(archive_pointer);
+    buffer_pool_release(&pool->buffers, &buffer);
+    if (stats != NULL) {
+        mutex_lock(&pool->mutex);
+        stats_merge(pool->stats, stats);
+        mutex_unlock(&pool->mutex);
+    }
+}
 
-        // Read compressed data
-        char *compressed_data = malloc(compressed_size);
-        if (fread(compressed_data, compressed_size, 1, archive_pointer) != 1) {
-            fclose(archive_pointer);
-            fprintf(stderr, "Could not read file data\n");
-            return 0;
+static int unpack_parallel(unpack_pool *pool, unpack_job *jobs, const size_t job_count, const unsigned int threads, progress_report *progress, archive_stats *stats) {
+    // Extract entries on a pool of threads, each holding one decompression buffer from a shared pool for every archive
+    memset(pool, 0, sizeof(unpack_pool));
+    pool->jobs = jobs;
+    pool->job_count = job_count;
+    pool->progress = progress;
+    pool->stats = stats;
+    mutex_init(&pool->mutex);
+    buffer_pool_init(&pool->buffers);
+    thread_handle *workers = threads > 1 ? malloc(threads * sizeof(thread_handle)) : NULL;
+    unsigned int worker_count = 0;
+    while (workers != NULL && worker_count < threads && thread_create(&workers[worker_count], unpack_worker, pool)) {
+        worker_count++;
+    }
+
+    // Extract on this thread if no workers could be started
+    if (worker_count == 0) {
+        unpack_worker(pool);
+    }
+    for (unsigned int i = 0; i < worker_count; i++) {
+        thread_join(workers[i]);
+    }
+
+    stats_pool(stats, pool->buffers.allocated_size, pool->buffers.allocation_count, pool->buffers.request_count);
+    buffer_pool_destroy(&pool->buffers);
+    mutex_destroy(&pool->mutex);
+    free(workers);
+    return !pool->failed;
+}
+
+static int unpack_sequential(const char *archive_path, const char *folder_path, progress_report *progress, archive_stats *stats) {
+    // Map archive into memory
+    file_mapping archive_mapping;
+    stats_timer timer;
+    stats_start(stats, &timer);
+    const int map_status = map_file(&archive_mapping, archive_path, true);
+    stats_calls(stats, STATS_MAP, 1);
+    stats_stop(stats, STATS_READ, &timer);
+    if (!map_status) {
+        fprintf(stderr, "Error opening archive %s\n", archive_path);
+        return 0;
+    }
+
+    // Create folder
+    make_folder(folder_path);
+
+    // Unpack all files in order, decoding headers and data directly from the mapping
+    archive_reader reader;
+    archive_reader_open(&reader, archive_mapping.data, archive_mapping.size);
+    archive_entry entry;
+    buffer_pool buffers;
+    buffer_pool_init(&buffers);
+    pool_buffer buffer = {NULL, 0};
+    int unpack_status = 1;
+    int status;
+    while (1) {
+        stats_start(stats, &timer);
+        status = archive_reader_next(&reader, &entry);
+        stats_stop(stats, STATS_SCAN, &timer);
+        if (status != 1) {
+            break;
         }
 
-        // Create file path
-        char *file_path = make_file_path(folder_path, filename);
+        // Print current filename
+        progress_message(progress, VERBOSITY_VERBOSE, "Extracting %s from %s...\n", entry.filename, archive_path);
 
         // Extract the file
-        if (compression_level == 0) {
-            // Print warning if compressed size does not match uncompressed size
-            if (compressed_size != uncompressed_size) {
-                fprintf(stderr, "Compressed size does not match uncompressed size\n");
-            }
+        if (!extract_entry(&entry, folder_path, &buffers, &buffer, stats, NULL)) {
+            unpack_status = 0;
+            break;
+        }
+        progress_advance(progress, entry.uncompressed_size);
+    }
+    buffer_pool_release(&buffers, &buffer);
+    stats_pool(stats, buffers.allocated_size, buffers.allocation_count, buffers.request_count);
+    buffer_pool_destroy(&buffers);
+    unmap_file(&archive_mapping);
+    if (!unpack_status) {
+        return 0;
+    }
 
-            // Open file
-            FILE *file_pointer = fopen(file_path, "wb");
-            free(file_path);
-            if (file_pointer == NULL) {
-                fclose(archive_pointer);
-                fprintf(stderr, "Error creating file\n");
-                return 0;
-            }
+    // Fail if archive is malformed
+    if (status == -1) {
+        fprintf(stderr, "%s in archive %s\n", reader.error, archive_path);
+        return 0;
+    }
 
-            // Write uncompressed data to file
-            const int write_status = fwrite(compressed_data, compressed_size, 1, file_pointer);
-            fclose(file_pointer);
-            free(compressed_data);
-            if (write_status != 1) {
-                fclose(archive_pointer);
-                fprintf(stderr, "Error writing file data\n");
-                return 0;
-            }
+    // Reached end, success
+    return 1;
+}
 
-        } else if (compression_level == 1) {
-            // Perform type 1 decompression
-            unsigned int compressed_pointer = 0;
-            char *uncompressed_data = malloc(uncompressed_size);
-            unsigned int uncompressed_pointer = 0;
-
-            // While there is still compressed data to read
-            while (compressed_pointer < compressed_size) {
-                // Read flag byte
-                const unsigned char flag = compressed_data[compressed_pointer++];
-
-                // Next byte is duplicated x times
-                if (flag > 127) {
-                    // Calculate times to duplicate
-                    const unsigned char count = flag - 125;
-
-                    // Duplicate byte and write to uncompressed data buffer
-                    for (unsigned char i = 0; i < count; i++) {
-                        uncompressed_data[uncompressed_pointer++] = compressed_data[compressed_pointer];
-                    }
-                    compressed_pointer++;
-                // Next x bytes are copied without duplication
-                } else {
-                    for (unsigned char i = 0; i < flag + 1; i++) {
-                        uncompressed_data[uncompressed_pointer++] = compressed_data[compressed_pointer++];
-                    }
+static int save_hashes(unpack_job *jobs, const size_t job_count, const unpack_options *options) {
+    // List the hashes of every entry decoded from each archive
+    int save_status = 1;
+    if (options->manifest_output_path != NULL) {
+        manifest_writer manifest;
+        if (manifest_open(&manifest, options->manifest_output_path)) {
+            for (size_t i = 0; i < job_count; i++) {
+                manifest_begin_archive(&manifest, jobs[i].archive_path);
+                for (size_t j = 0; j < jobs[i].index.entry_count; j++) {
+                    const archive_entry *entry = &jobs[i].index.entries[j];
+                    manifest_add(&manifest, entry->filename, entry->compression_level, entry->compressed_size, entry->uncompressed_size, jobs[i].hashes[j]);
                 }
+                manifest_end_archive(&manifest);
             }
+            save_status = manifest_close(&manifest);
+        } else {
+            save_status = 0;
+        }
+        if (!save_status) {
+            fprintf(stderr, "Error writing manifest %s\n", options->manifest_output_path);
+        }
+    }
 
-            // Free compressed data from memory
-            free(compressed_data);
-
-            // Print warning if output size does not match expected size
-            if (uncompressed_pointer != uncompressed_size) {
-                fprintf(stderr, "Output size does not match expected size\n");
-            }
+    // Index each archive which was read to the end, using the hashes in place of any it already had
+    for (size_t i = 0; options->write_index && i < job_count; i++) {
+        if (jobs[i].index.error != NULL) {
+            continue;
+        }
+        free(jobs[i].index.hashes);
+        jobs[i].index.hashes = jobs[i].hashes;
+        jobs[i].hashes = NULL;
+        if (!archive_index_save(&jobs[i].index, jobs[i].archive_path, jobs[i].mapping.data)) {
+            fprintf(stderr, "Error writing index for archive %s\n", jobs[i].archive_path);
+            save_status = 0;
+        }
+    }
+    return save_status;
+}
 
-            // Open file
-            FILE *file_pointer = fopen(file_path, "wb");
-            free(file_path);
-            if (file_pointer == NULL) {
-                fclose(archive_pointer);
-                free(uncompressed_data);
-                fprintf(stderr, "Error creating file\n");
-                return 0;
-            }
+int unpack(const char *archive_path, const char *folder_path, const unpack_options *options) {
+    progress_report progress;
+    progress_begin(&progress, stdout, options->message_level, "Unpacked");
+    stats_begin(options->stats);
+    int unpack_status;
+    const bool hash_entries = options->write_index || options->manifest_output_path != NULL;
+    if (options->threads > 1 || hash_entries) {
+        // Index all entries, then extract them in parallel
+        unpack_job job;
+        unpack_pool pool;
+        unpack_status = open_job(&job, archive_path, folder_path, hash_entries, options->stats)
+            && unpack_parallel(&pool, &job, 1, options->threads, &progress, options->stats);
+
+        // Fail if archive is malformed
+        if (unpack_status && job.index.error != NULL) {
+            fprintf(stderr, "%s in archive %s\n", job.index.error, archive_path);
+            unpack_status = 0;
+        }
+        if (unpack_status && hash_entries) {
+            unpack_status = save_hashes(&job, 1, options);
+        }
+        close_job(&job);
+    } else {
+        unpack_status = unpack_sequential(archive_path, folder_path, &progress, options->stats);
+    }
+    stats_end(options->stats);
+    progress_end(&progress);
+    return unpack_status;
+}
 
-            // Write uncompressed data to file
-            const int write_status = fwrite(uncompressed_data, uncompressed_size, 1, file_pointer);
-            fclose(file_pointer);
-            free(uncompressed_data);
-            if (write_status != 1) {
-                fclose(archive_pointer);
-                fprintf(stderr, "Error writing file data\n");
-                return 0;
-            }
+static char **split_lines(const char *text, const size_t size, size_t *line_count) {
+    // Count lines to size the array of lines, which is followed by their text in the same allocation
+    size_t line_capacity = 1;
+    for (size_t i = 0; i < size; i++) {
+        line_capacity += text[i] == '\n';
+    }
+    char **lines = malloc(line_capacity * sizeof(char *) + size + 1);
+    if (lines == NULL) {
+        return NULL;
+    }
+    char *line_text = (char *) &lines[line_capacity];
+    memcpy(line_text, text, size);
+    line_text[size] = '\0';
+
+    // Split text at line breaks, ignoring surrounding whitespace and blank lines
+    *line_count = 0;
+    for (size_t line_start = 0, line_end; line_start <= size; line_start = line_end + 1) {
+        for (line_end = line_start; line_end < size && line_text[line_end] != '\n'; line_end++);
+        size_t start = line_start;
+        size_t end = line_end;
+        while (start < end && isspace((unsigned char) line_text[start])) {
+            start++;
+        }
+        while (end > start && isspace((unsigned char) line_text[end - 1])) {
+            end--;
+        }
+        if (start < end) {
+            line_text[end] = '\0';
+            lines[(*line_count)++] = &line_text[start];
+        }
+    }
+    return lines;
+}
 
-        } else if (compression_level > 1) {
-            // Calculate bits used for offset and run length
-            const unsigned char offset_bits = 6 - compression_level;
-            if ( offset_bits > 8 ) {
-                free(file_path);
-                free(compressed_data);
-                fprintf(stderr, "Unsupported run and offset length\n");
-                continue;
+static const char *archive_name(const char *archive_path) {
+    // Find the last component of the path, after either kind of separator on Windows
+    const char *name = archive_path;
+    for (const char *character = archive_path; *character != '\0'; character++) {
+        #ifdef _WIN32
+            if (*character == '/' || *character == '\\' || *character == ':') {
+                name = character + 1;
             }
-            const unsigned char run_length_bits = 8 - offset_bits;
-            const unsigned int max_run_length = (1 << run_length_bits) + 2;
-            const int max_offset = (1 << ( offset_bits + 8)) - 1;
-
-            // Create compressed pointer
-            uint_fast32_t compressed_pointer = 0;
-
-            // Create uncompressed buffer and pointer
-            char *uncompressed_data = malloc(uncompressed_size);
-            uint_fast32_t uncompressed_pointer = 0;
-
-            // Create circular buffer
-            char *circular_buffer = malloc(max_offset);
-            int circular_offset = 0;
-
-            // While there is still compressed data to read
-            while (compressed_pointer < compressed_size) {
-                // Read flag byte
-                const char flag = compressed_data[compressed_pointer++];
-
-                for (unsigned char bit = 0; bit < 8; bit++) {
-                    // If data is uncompressed
-                    if (((flag >> bit) & 1) == 1) {
-                        // Get byte from compressed buffer
-                        char *byte = &compressed_data[compressed_pointer++];
-
-                        // Write byte to uncompressed buffer and circular buffer
-                        uncompressed_data[uncompressed_pointer++] = *byte;
-
-                        // Write byte to circular buffer
-                        circular_buffer[circular_offset] = *byte;
-                        if ( circular_offset < max_offset ) {
-                            circular_offset++;
-                        } else {
-                            circular_offset = 0;
-                        }
-
-                    // If data is compressed
-                    } else {
-                        // Get offset and run length
-                        int offset = -1;
-                        unsigned int count = 0;
-                        for (unsigned char i = 0; i < 8; i++, count++) {
-                            if (((compressed_data[compressed_pointer] >> i) & 1) == 1) {
-                                offset += 1 << count;
-                            }
-                        }
-                        compressed_pointer++;
-                        unsigned int run_length = 2;
-                        for (unsigned char i = 0; i < 8; i++, count++) {
-                            if ( i == offset_bits ) {
-                                count = 0;
-                            }
-                            if (((compressed_data[compressed_pointer] >> i) & 1) == 1) {
-                                if ( i >= offset_bits ) {
-                                    run_length += 1 << count;
-                                } else {
-                                    offset += 1 << count;
-                                }
-                            }
-                        }
-                        compressed_pointer++;
-
-                        // Check offset is valid
-                        if (offset < 0) {
-                            printf("'%s' has invalid offset during decompression\n", filename);
-                            goto ESCAPE_LOOP;
-                        }
-
-                        // Check run length is valid
-                        if (run_length > max_run_length) {
-                            printf("'%s' has invalid run length during decompression\n", filename);
-                            goto ESCAPE_LOOP;
-                        }
-
-                        // For each byte in run length
-                        for (unsigned int i = 0; i < run_length; i++) {
-
-                            // Check offset is valid
-                            if (offset > max_offset || offset >= uncompressed_pointer) {
-                                printf("'%s' has invalid offset during decompression\n", filename);
-                                goto ESCAPE_LOOP;
-                            }
-
-                            // Read byte from circular buffer
-                            const char *byte = &circular_buffer[offset];
-
-                            // Write byte to circular buffer
-                            circular_buffer[circular_offset] = *byte;
-                            if ( circular_offset < max_offset ) {
-                                circular_offset++;
-                            } else {
-                                circular_offset = 0;
-                            }
-
-                            // Write byte to uncompressed buffer
-                            uncompressed_data[uncompressed_pointer++] = *byte;
-
-                            // Calculate next offset
-                            if ( offset < max_offset ) {
-                                offset++;
-                            } else {
-                                offset = 0;
-                            }
-                        }
-                    }
-                    if (compressed_pointer >= compressed_size) {
-                        break;
-                    }
-                }
+        #else
+            if (*character == '/') {
+                name = character + 1;
             }
+        #endif
+    }
+    return name;
+}
 
-            // Free circular buffer and compressed data from memory
-            free(circular_buffer);
-            free(compressed_data);
+static int compare_archive_names(const void *first, const void *second) {
+    return compare_filenames(archive_name(*(const char **) first), archive_name(*(const char **) second));
+}
 
-            // Check file matches expected size
-            ESCAPE_LOOP:if (uncompressed_pointer != uncompressed_size || compressed_pointer != compressed_size) {
-                printf("'%s' does not match expected size\n", filename);
-            }
+static int check_archive_names(const char **archive_paths, const size_t archive_count, const char *folder_path) {
+    // Sort archives by name, ignoring case as some file systems do, so that any sharing a folder are adjacent
+    const char **sorted_paths = malloc(archive_count * sizeof(char *));
+    if (sorted_paths == NULL && archive_count > 0) {
+        fprintf(stderr, "Could not allocate memory for batch\n");
+        return 0;
+    }
+    memcpy(sorted_paths, archive_paths, archive_count * sizeof(char *));
+    qsort(sorted_paths, archive_count, sizeof(char *), compare_archive_names);
+
+    // Refuse to unpack archives into the same folder, as their files would be written over each other at once
+    int check_status = 1;
+    for (size_t i = 1; i < archive_count; i++) {
+        if (compare_archive_names(&sorted_paths[i - 1], &sorted_paths[i]) == 0) {
+            fprintf(stderr, "Archives %s and %s would both be unpacked into %s/%s\n", sorted_paths[i - 1], sorted_paths[i], folder_path, archive_name(sorted_paths[i]));
+            check_status = 0;
+        }
+    }
+    free(sorted_paths);
+    return check_status;
+}
 
-            // Open file
-            FILE *file_pointer = fopen(file_path, "wb");
-            free(file_path);
-            if (file_pointer == NULL) {
-                fclose(archive_pointer);
-                fprintf(stderr, "Error opening file\n");
-                return 0;
+int unpack_batch(const char **archive_paths, const size_t archive_count, const char *folder_path, const unpack_options *options) {
+    progress_report progress;
+    progress_begin(&progress, stdout, options->message_level, folder_path != NULL ? "Unpacked" : "Tested");
+    archive_stats *stats = options->stats;
+    stats_begin(stats);
+    const bool hash_entries = options->write_index || options->manifest_output_path != NULL;
+
+    // Expand lists of archives given as @file into one list
+    size_t path_count = 0;
+    const char **paths = NULL;
+    char ***list_lines = calloc(archive_count, sizeof(char **));
+    int batch_status = list_lines != NULL;
+    for (size_t i = 0; i < archive_count && batch_status; i++) {
+        size_t line_count = 1;
+        const char **new_paths = &archive_paths[i];
+        if (archive_paths[i][0] == '@') {
+            file_mapping list_mapping;
+            if (!map_file(&list_mapping, &archive_paths[i][1], true)) {
+                fprintf(stderr, "Error opening list %s\n", &archive_paths[i][1]);
+                batch_status = 0;
+                break;
             }
+            list_lines[i] = split_lines((const char *) list_mapping.data, list_mapping.size, &line_count);
+            unmap_file(&list_mapping);
+            new_paths = (const char **) list_lines[i];
+        }
+        const char **grown_paths = new_paths != NULL ? realloc(paths, (path_count + line_count + 1) * sizeof(char *)) : NULL;
+        if (grown_paths == NULL) {
+            fprintf(stderr, "Could not allocate memory for batch\n");
+            batch_status = 0;
+            break;
+        }
+        paths = grown_paths;
+        memcpy(&paths[path_count], new_paths, line_count * sizeof(char *));
+        path_count += line_count;
+    }
 
-            // Copy from memory to file
-            const int write_status = fwrite(uncompressed_data, uncompressed_size, 1, file_pointer);
-            fclose(file_pointer);
-            free(uncompressed_data);
-            if (write_status != 1) {
-                fclose(archive_pointer);
-                fprintf(stderr, "Error writing file data\n");
-                return 0;
+    // Open every archive, each unpacked into a folder named after it unless only testing
+    if (batch_status && folder_path != NULL) {
+        batch_status = check_archive_names(paths, path_count, folder_path);
+        if (batch_status) {
+            make_folder(folder_path);
+        }
+    }
+    unpack_job *jobs = batch_status ? calloc(path_count, sizeof(unpack_job)) : NULL;
+    if (batch_status && jobs == NULL && path_count > 0) {
+        fprintf(stderr, "Could not allocate memory for batch\n");
+        batch_status = 0;
+    }
+    size_t job_count = 0;
+    for (size_t i = 0; i < path_count && jobs != NULL; i++) {
+        char *archive_folder_path = folder_path != NULL ? make_file_path(folder_path, archive_name(paths[i])) : NULL;
+        batch_status = open_job(&jobs[job_count++], paths[i], archive_folder_path, hash_entries, stats) && batch_status;
+        free(archive_folder_path);
+    }
+
+    // Extract all entries of all archives on one pool of threads
+    if (jobs != NULL) {
+        unpack_pool pool;
+        batch_status = unpack_parallel(&pool, jobs, job_count, options->threads, &progress, stats) && batch_status;
+
+        // Report malformed archives, then write hashes of every entry decoded
+        for (size_t i = 0; i < job_count; i++) {
+            if (jobs[i].index.error != NULL) {
+                fprintf(stderr, "%s in archive %s\n", jobs[i].index.error, jobs[i].archive_path);
+                batch_status = 0;
             }
+        }
+        if (batch_status && hash_entries) {
+            batch_status = save_hashes(jobs, job_count, options);
+        }
+        for (size_t i = 0; i < job_count; i++) {
+            close_job(&jobs[i]);
+        }
+        if (pool.mismatch_count > 0) {
+            fprintf(stderr, "%zu files do not match their headers\n", pool.mismatch_count);
+            batch_status = 0;
+        }
+    }
 
-        } else {
-            fclose(archive_pointer);
-            return 0;
+    free(jobs);
+    free(paths);
+    for (size_t i = 0; list_lines != NULL && i < archive_count; i++) {
+        free(list_lines[i]);
+    }
+    free(list_lines);
+    stats_end(stats);
+    progress_end(&progress);
+    return batch_status;
+}
+
+int test_archives(const char **archive_paths, const size_t archive_count, const unpack_options *options) {
+    return unpack_batch(archive_paths, archive_count, NULL, options);
+}
+
+int extract(const char *archive_path, const char *folder_path, const char **filenames, const size_t filename_count, const verbosity message_level, archive_stats *stats) {
+    // Map archive into memory, where only the headers and requested entries will be read
+    stats_begin(stats);
+    file_mapping archive_mapping;
+    stats_timer timer;
+    stats_start(stats, &timer);
+    const int map_status = map_file(&archive_mapping, archive_path, false);
+    stats_calls(stats, STATS_MAP, 1);
+    stats_stop(stats, STATS_READ, &timer);
+    if (!map_status) {
+        fprintf(stderr, "Error opening archive %s\n", archive_path);
+        stats_end(stats);
+        return 0;
+    }
+
+    // Index entries, failing only if the requested entries are not found before an error
+    archive_index index;
+    stats_start(stats, &timer);
+    const int index_status = archive_index_open(&index, archive_path, archive_mapping.data, archive_mapping.size);
+    stats_stop(stats, STATS_SCAN, &timer);
+    if (!index_status) {
+        fprintf(stderr, "%s in archive %s\n", index.error, archive_path);
+    }
+
+    // Extract each requested entry
+    progress_report progress;
+    progress_begin(&progress, stdout, message_level, "Extracted");
+    int extract_status = 1;
+    buffer_pool buffers;
+    buffer_pool_init(&buffers);
+    pool_buffer buffer = {NULL, 0};
+    for (size_t i = 0; i < filename_count; i++) {
+        const archive_entry *entry = archive_index_find(&index, filenames[i]);
+        if (entry == NULL) {
+            fprintf(stderr, "Could not find %s in archive %s\n", filenames[i], archive_path);
+            extract_status = 0;
+            continue;
         }
 
-        // Seek to next file positon
-        seek = fseek(archive_pointer, position + compressed_size, SEEK_SET);
-        if (seek) {
-            fclose(archive_pointer);
-            return seek;
+        // Print current filename
+        progress_message(&progress, VERBOSITY_VERBOSE, "Extracting %s from %s...\n", entry->filename, archive_path);
+
+        if (!extract_entry(entry, folder_path, &buffers, &buffer, stats, NULL)) {
+            extract_status = 0;
+            break;
         }
+        progress_advance(&progress, entry->uncompressed_size);
     }
 
-    // Close archive and return success code
-    fclose(archive_pointer);
-    return 1;
+    buffer_pool_release(&buffers, &buffer);
+    stats_pool(stats, buffers.allocated_size, buffers.allocation_count, buffers.request_count);
+    buffer_pool_destroy(&buffers);
+    archive_index_free(&index);
+    unmap_file(&archive_mapping);
+    stats_end(stats);
+    progress_end(&progress);
+    return extract_status;
+}
+
+int index_archive(const char *archive_path, const verbosity message_level) {
+    // Map archive into memory
+    file_mapping archive_mapping;
+    if (!map_file(&archive_mapping, archive_path, true)) {
+        fprintf(stderr, "Error opening archive %s\n", archive_path);
+        return 0;
+    }
+
+    // Index and hash every entry, refusing to index a malformed archive
+    progress_report progress;
+    progress_begin(&progress, stdout, message_level, "Indexed");
+    progress_message(&progress, VERBOSITY_VERBOSE, "Indexing %s...\n", archive_path);
+    archive_index index;
+    int index_status = archive_index_build(&index, archive_mapping.data, archive_mapping.size);
+    if (!index_status) {
+        fprintf(stderr, "%s in archive %s\n", index.error, archive_path);
+    } else if (!archive_index_hash(&index) || !archive_index_save(&index, archive_path, archive_mapping.data)) {
+        fprintf(stderr, "Error writing index for archive %s\n", archive_path);
+        index_status = 0;
+    }
+    for (size_t i = 0; index_status && i < index.entry_count; i++) {
+        progress_advance(&progress, index.entries[i].uncompressed_size);
+    }
+    progress_end(&progress);
+
+    archive_index_free(&index);
+    unmap_file(&archive_mapping);
+    return index_status;
 }
 
-int pack(const char *folder_path, const char *archive_path) {
+typedef struct {
+    char filename[FILENAME_SIZE];
+    size_t cost;
+    unsigned char *data;
+    size_t compressed_size;
+    size_t uncompressed_size;
+    unsigned char compression_level;
+    uint64_t hash;
+    size_t rank;
+    int status;
+} pack_entry;
+
+static int list_folder(const char *folder_path, const pack_options *options, progress_report *progress, pack_entry **entries, size_t *entry_count) {
     // Open folder
     DIR *folder_pointer = NULL;
     if ((folder_pointer = opendir(folder_path)) == NULL) {
@@ -401,15 +889,10 @@ int pack(const char *folder_path, const char *archive_path) {
         return 0;
     }
 
-    // Open archive
-    FILE *archive_pointer = NULL;
-    if ((archive_pointer = fopen(archive_path, "wb")) == NULL) {
-        closedir(folder_pointer);
-        fprintf(stderr, "Error opening archive %s\n", archive_path);
-        return 0;
-    }
-
     // For each file in folder
+    size_t entry_capacity = 0;
+    *entries = NULL;
+    *entry_count = 0;
     struct dirent* file_entry;
     while ((file_entry = readdir(folder_pointer))) {
         // Skip . and .. mappings
@@ -419,80 +902,963 @@ int pack(const char *folder_path, const char *archive_path) {
 
         // Skip files with long names
         if (strlen(file_entry->d_name) >= FILENAME_SIZE) {
-            printf("Skipping file with long filename %s\n", file_entry->d_name);
+            progress_message(progress, VERBOSITY_PROGRESS, "Skipping file with long filename %s\n", file_entry->d_name);
             continue;
         }
 
-        // Print current filename
-        printf("Adding %s to %s...\n", file_entry->d_name, archive_path);
-
-        // Open file
+        // Skip folders, as archives do not support them
+        struct stat file_stat;
         char *file_path = make_file_path(folder_path, file_entry->d_name);
-        FILE *file_pointer = fopen(file_path, "rb");
+        const int stat_status = stat(file_path, &file_stat);
         free(file_path);
-        if (file_pointer == NULL) {
-            fprintf(stderr, "Error opening file\n");
-            return 0;
-        }
-
-        // Get file size
-        const size_t file_size = get_file_size(file_pointer);
-        if (file_size > UINT32_MAX) {
-            fprintf(stderr, "File is too large\n");
-            free(file_pointer);
-            return 0;
+        if (stat_status == 0 && (file_stat.st_mode & S_IFMT) == S_IFDIR) {
+            progress_message(progress, VERBOSITY_PROGRESS, "Skipping folder %s\n", file_entry->d_name);
+            continue;
         }
 
-        // Read file data
-        char *file_data = malloc(file_size);
-        fread(file_data, file_size, 1, file_pointer);
-        fclose(file_pointer);
-
-        // Convert file size to byte array
-        char file_size_bytes[4];
-        for (int i = 0; i < 4; i++) {
-            file_size_bytes[i] = (file_size >> 8 * i) & 0xFF;
-        }
-
-        // Create metadata
-        const int metadata_size = strlen(file_entry->d_name) + 10;
-        char *metadata = malloc(metadata_size);
-        strcpy(metadata, file_entry->d_name);
-        memcpy(&metadata[metadata_size - 9], &file_size_bytes, 4);
-        memcpy(&metadata[metadata_size - 5], &file_size_bytes, 4);
-        metadata[metadata_size - 1] = '\0';
-
-        // Write metadata to arhive
-        int write_status = fwrite(metadata, metadata_size, 1, archive_pointer);
-        free(metadata);
-        if (write_status != 1) {
-            closedir(folder_pointer);
-            fclose(archive_pointer);
-            fprintf(stderr, "Error writing metadata to archive\n");
-            return 0;
+        // Add file to list
+        if (*entry_count == entry_capacity) {
+            entry_capacity = entry_capacity ? entry_capacity * 2 : 64;
+            pack_entry *grown_entries = realloc(*entries, entry_capacity * sizeof(pack_entry));
+            if (grown_entries == NULL) {
+                closedir(folder_pointer);
+                free(*entries);
+                fprintf(stderr, "Could not allocate memory for %s\n", folder_path);
+                return 0;
+            }
+            *entries = grown_entries;
         }
-
-        // Write file data to archive
-        write_status = fwrite(file_data, file_size, 1, archive_pointer);
-        free(file_data);
-        if (write_status != 1) {
-            closedir(folder_pointer);
-            fclose(archive_pointer);
-            fprintf(stderr, "Error writing file data to archive\n");
-            return 0;
+        pack_entry *entry = &(*entries)[(*entry_count)++];
+        memset(entry, 0, sizeof(pack_entry));
+        strcpy(entry->filename, file_entry->d_name);
+
+        // Estimate memory needed for the file and its compressed data
+        if (stat_status == 0) {
+            entry->cost = file_stat.st_size;
+            if (options->compression_level > 0) {
+                entry->cost += compress_bound(file_stat.st_size, options->compression_level);
+            }
         }
     }
 
     // Close folder
     closedir(folder_pointer);
+    return 1;
+}
+
+static int read_manifest(const char *manifest_path, char (**filenames)[FILENAME_SIZE], size_t *filename_count) {
+    file_mapping manifest_mapping;
+    if (!map_file(&manifest_mapping, manifest_path, true)) {
+        fprintf(stderr, "Error opening manifest %s\n", manifest_path);
+        return 0;
+    }
+    *filenames = NULL;
+    *filename_count = 0;
+
+    // Take the order of an archive's entries
+    archive_index index;
+    if (archive_index_build(&index, manifest_mapping.data, manifest_mapping.size) && index.entry_count > 0) {
+        *filenames = malloc(index.entry_count * FILENAME_SIZE);
+        for (size_t i = 0; *filenames != NULL && i < index.entry_count; i++) {
+            strcpy((*filenames)[i], index.entries[i].filename);
+        }
+        *filename_count = index.entry_count;
+        archive_index_free(&index);
+        unmap_file(&manifest_mapping);
+        return *filenames != NULL;
+    }
+    archive_index_free(&index);
+
+    // Otherwise read one filename per line
+    size_t line_count;
+    char **lines = split_lines((const char *) manifest_mapping.data, manifest_mapping.size, &line_count);
+    unmap_file(&manifest_mapping);
+    *filenames = lines != NULL ? malloc(line_count * FILENAME_SIZE + 1) : NULL;
+    if (*filenames == NULL) {
+        free(lines);
+        return 0;
+    }
+    for (size_t i = 0; i < line_count; i++) {
+        if (strlen(lines[i]) < FILENAME_SIZE) {
+            strcpy((*filenames)[(*filename_count)++], lines[i]);
+        }
+    }
+    free(lines);
+    return 1;
+}
+
+static const char *get_extension(const char *filename) {
+    const char *extension = strrchr(filename, '.');
+    return extension != NULL ? extension : "";
+}
+
+static int compare_pack_entries(const void *first, const void *second) {
+    // Sort by rank, then by filename, with case only breaking ties so the order never depends on the folder
+    const pack_entry *first_entry = first;
+    const pack_entry *second_entry = second;
+    if (first_entry->rank != second_entry->rank) {
+        return (first_entry->rank > second_entry->rank) - (first_entry->rank < second_entry->rank);
+    }
+    const int difference = compare_filenames(first_entry->filename, second_entry->filename);
+    if (difference != 0) {
+        return difference;
+    }
+    return strcmp(first_entry->filename, second_entry->filename);
+}
+
+static int compare_pack_entry_types(const void *first, const void *second) {
+    // Group files with the same extension together, sorted by filename within each group
+    const pack_entry *first_entry = first;
+    const pack_entry *second_entry = second;
+    const int difference = compare_filenames(get_extension(first_entry->filename), get_extension(second_entry->filename));
+    if (difference != 0) {
+        return difference;
+    }
+    return compare_pack_entries(first, second);
+}
+
+static int sort_entries(pack_entry *entries, const size_t entry_count, const pack_options *options) {
+    switch (options->order) {
+        case PACK_ORDER_FOLDER:
+            break;
+
+        case PACK_ORDER_NAME:
+            qsort(entries, entry_count, sizeof(pack_entry), compare_pack_entries);
+            break;
+
+        case PACK_ORDER_TYPE:
+            qsort(entries, entry_count, sizeof(pack_entry), compare_pack_entry_types);
+            break;
+
+        // Rank files by their first position in the manifest, followed by any files it does not list
+        case PACK_ORDER_MANIFEST: {
+            char (*filenames)[FILENAME_SIZE];
+            size_t filename_count;
+            if (!read_manifest(options->manifest_path, &filenames, &filename_count)) {
+                return 0;
+            }
+            for (size_t i = 0; i < entry_count; i++) {
+                entries[i].rank = filename_count;
+                for (size_t j = 0; j < filename_count; j++) {
+                    if (compare_filenames(entries[i].filename, filenames[j]) == 0) {
+                        entries[i].rank = j;
+                        break;
+                    }
+                }
+            }
+            free(filenames);
+            qsort(entries, entry_count, sizeof(pack_entry), compare_pack_entries);
+            break;
+        }
+    }
+    return 1;
+}
+
+static int load_entry(const char *folder_path, const pack_options *options, pack_entry *entry, archive_stats *stats) {
+    // Map file, which is read in blocks if it cannot be mapped
+    stats_timer timer;
+    stats_start(stats, &timer);
+    char *file_path = make_file_path(folder_path, entry->filename);
+    file_mapping mapping;
+    const int map_status = map_file(&mapping, file_path, true);
+    free(file_path);
+    stats_calls(stats, STATS_MAP, 1);
+    if (!map_status) {
+        stats_stop(stats, STATS_READ, &timer);
+        fprintf(stderr, "Error opening file\n");
+        return 0;
+    }
+
+    // Ensure file size fits in header
+    const size_t file_size = mapping.size;
+    if (file_size > UINT32_MAX) {
+        unmap_file(&mapping);
+        fprintf(stderr, "File is too large\n");
+        return 0;
+    }
+    if (options->write_index || options->manifest_output_path != NULL) {
+        entry->hash = hash_data(mapping.data, file_size);
+    }
+    entry->compressed_size = file_size;
+    entry->uncompressed_size = file_size;
+    entry->compression_level = options->compression_level;
+
+    // Copy uncompressed file data
+    if (options->compression_level == 0) {
+        entry->data = malloc(file_size);
+        const int copy_status = file_size == 0 || entry->data != NULL;
+        if (copy_status) {
+            memcpy(entry->data, mapping.data, file_size);
+        }
+        unmap_file(&mapping);
+        stats_stop(stats, STATS_READ, &timer);
+        stats_buffer(stats, file_size);
+        if (!copy_status) {
+            fprintf(stderr, "Error reading file\n");
+        }
+        return copy_status;
+    }
+
+    // Compress file data straight from the mapping
+    stats_stop(stats, STATS_READ, &timer);
+    const size_t bound = compress_bound(file_size, options->compression_level);
+    entry->data = malloc(bound);
+    if (bound > UINT32_MAX || (bound > 0 && entry->data == NULL)) {
+        unmap_file(&mapping);
+        fprintf(stderr, "File is too large\n");
+        return 0;
+    }
+    stats_buffer(stats, bound);
+    stats_start(stats, &timer);
+    const int compress_status = options->compression_level == COMPRESSION_AUTO
+        ? compress_auto(mapping.data, file_size, entry->data, &entry->compressed_size, &entry->compression_level, options->effort)
+        : compress(mapping.data, file_size, entry->data, &entry->compressed_size, options->compression_level, options->effort);
+    unmap_file(&mapping);
+    stats_stop(stats, STATS_COMPRESS, &timer);
+    if (!compress_status) {
+        fprintf(stderr, "Error compressing file\n");
+        return 0;
+    }
+    return 1;
+}
+
+static int write_metadata(FILE *archive_pointer, const pack_entry *entry) {
+    // Create metadata
+    unsigned char metadata[FILENAME_SIZE + HEADER_SIZE];
+    const size_t metadata_size = write_entry_header(metadata, entry->filename, entry->compressed_size, entry->uncompressed_size, entry->compression_level);
+
+    // Write metadata to arhive
+    if (fwrite(metadata, metadata_size, 1, archive_pointer) != 1) {
+        fprintf(stderr, "Error writing metadata to archive\n");
+        return 0;
+    }
+    return 1;
+}
+
+static int write_entry(FILE *archive_pointer, const pack_entry *entry, archive_stats *stats) {
+    stats_timer timer;
+    stats_start(stats, &timer);
+    stats_calls(stats, STATS_WRITE_CALL, 1 + (entry->compressed_size > 0));
+    const int metadata_status = write_metadata(archive_pointer, entry);
+
+    // Write file data to archive
+    const int write_status = metadata_status && (entry->compressed_size == 0 || fwrite(entry->data, entry->compressed_size, 1, archive_pointer) == 1);
+    stats_stop(stats, STATS_WRITE, &timer);
+    if (!metadata_status) {
+        return 0;
+    }
+    if (!write_status) {
+        fprintf(stderr, "Error writing file data to archive\n");
+        return 0;
+    }
+    stats_entry(stats, entry->compression_level, entry->uncompressed_size, entry->compressed_size);
+    return 1;
+}
+
+// Uncompressed files are copied into archives through a buffer of this size
+#define COPY_BUFFER_SIZE 65536
+
+static int copy_entry(FILE *archive_pointer, const char *folder_path, const pack_options *options, pack_entry *entry, archive_stats *stats) {
+    // Open file, taking its size for the header from the file system as it is copied after the header
+    stats_timer timer;
+    stats_start(stats, &timer);
+    char *file_path = make_file_path(folder_path, entry->filename);
+    struct stat file_stat;
+    FILE *file_pointer = stat(file_path, &file_stat) == 0 ? fopen(file_path, "rb") : NULL;
+    free(file_path);
+    stats_calls(stats, STATS_OPEN, 1);
+    stats_stop(stats, STATS_READ, &timer);
+    if (file_pointer == NULL) {
+        fprintf(stderr, "Error opening file\n");
+        return 0;
+    }
+    if ((uint64_t) file_stat.st_size > UINT32_MAX) {
+        fclose(file_pointer);
+        fprintf(stderr, "File is too large\n");
+        return 0;
+    }
+    entry->compressed_size = file_stat.st_size;
+    entry->uncompressed_size = file_stat.st_size;
+    entry->compression_level = 0;
+
+    // Write metadata, then copy file data a buffer at a time
+    unsigned char *buffer = malloc(COPY_BUFFER_SIZE);
+    stats_buffer(stats, COPY_BUFFER_SIZE);
+    stats_calls(stats, STATS_WRITE_CALL, 1);
+    if (buffer == NULL || !write_metadata(archive_pointer, entry)) {
+        free(buffer);
+        fclose(file_pointer);
+        return 0;
+    }
+    hash_state hash;
+    hash_reset(&hash);
+    size_t copied_size = 0;
+    size_t read_size;
+    int copy_status = 1;
+    while (copy_status) {
+        stats_start(stats, &timer);
+        read_size = fread(buffer, 1, COPY_BUFFER_SIZE, file_pointer);
+        stats_calls(stats, STATS_READ_CALL, 1);
+        if (read_size > 0 && (options->write_index || options->manifest_output_path != NULL)) {
+            hash_update(&hash, buffer, read_size);
+        }
+        stats_stop(stats, STATS_READ, &timer);
+        if (read_size == 0) {
+            break;
+        }
+        stats_start(stats, &timer);
+        copy_status = read_size <= entry->uncompressed_size - copied_size && fwrite(buffer, read_size, 1, archive_pointer) == 1;
+        stats_calls(stats, STATS_WRITE_CALL, 1);
+        stats_stop(stats, STATS_WRITE, &timer);
+        copied_size += read_size;
+    }
+    copy_status = copy_status && !ferror(file_pointer) && copied_size == entry->uncompressed_size;
+    fclose(file_pointer);
+    free(buffer);
+    if (!copy_status) {
+        fprintf(stderr, "Error copying file data to archive\n");
+        return 0;
+    }
+    if (options->write_index || options->manifest_output_path != NULL) {
+        entry->hash = hash_digest(&hash);
+    }
+    stats_entry(stats, 0, entry->uncompressed_size, entry->compressed_size);
+    return 1;
+}
+
+typedef struct {
+    pack_entry *entries;
+    size_t entry_count;
+    const char *folder_path;
+    const pack_options *options;
+    thread_mutex mutex;
+    thread_condition entry_loaded;
+    thread_condition memory_released;
+    size_t next_entry;
+    size_t memory_used;
+    size_t peak_memory_used;
+    archive_stats *stats;
+    bool failed;
+} pack_pool;
+
+static void pack_worker(void *argument) {
+    pack_pool *pool = argument;
+
+    // Gather statistics apart from other threads, adding them to the pool's when done
+    archive_stats worker_stats;
+    archive_stats *stats = pool->stats != NULL ? &worker_stats : NULL;
+    if (stats != NULL) {
+        memset(stats, 0, sizeof(archive_stats));
+    }
+
+    while (1) {
+        // Claim entries in order once their memory fits in the budget, so the next entry
+        // to be written can always be loaded while later entries wait to be written
+        mutex_lock(&pool->mutex);
+        while (!pool->failed && pool->next_entry < pool->entry_count && pool->memory_used > 0 && pool->memory_used + pool->entries[pool->next_entry].cost > pool->options->memory_budget) {
+            condition_wait(&pool->memory_released, &pool->mutex);
+        }
+        if (pool->failed || pool->next_entry == pool->entry_count) {
+            mutex_unlock(&pool->mutex);
+            break;
+        }
+        pack_entry *entry = &pool->entries[pool->next_entry++];
+        pool->memory_used += entry->cost;
+        if (pool->memory_used > pool->peak_memory_used) {
+            pool->peak_memory_used = pool->memory_used;
+        }
+        mutex_unlock(&pool->mutex);
+
+        // Read and compress file
+        const int status = load_entry(pool->folder_path, pool->options, entry, stats) ? 1 : -1;
+
+        // Hand entry to writer
+        mutex_lock(&pool->mutex);
+        entry->status = status;
+        condition_broadcast(&pool->entry_loaded);
+        mutex_unlock(&pool->mutex);
+    }
+
+    if (stats != NULL) {
+        mutex_lock(&pool->mutex);
+        stats_merge(pool->stats, stats);
+        mutex_unlock(&pool->mutex);
+    }
+}
+
+static int pack_parallel(pack_entry *entries, const size_t entry_count, const char *folder_path, const char *archive_path, const pack_options *options, FILE *archive_pointer, progress_report *progress) {
+    // Read and compress files on a pool of threads
+    pack_pool pool;
+    memset(&pool, 0, sizeof(pack_pool));
+    pool.entries = entries;
+    pool.entry_count = entry_count;
+    pool.folder_path = folder_path;
+    pool.options = options;
+    pool.stats = options->stats;
+    archive_stats writer_stats;
+    archive_stats *stats = options->stats != NULL ? &writer_stats : NULL;
+    if (stats != NULL) {
+        memset(stats, 0, sizeof(archive_stats));
+    }
+    mutex_init(&pool.mutex);
+    condition_init(&pool.entry_loaded);
+    condition_init(&pool.memory_released);
+    thread_handle *workers = malloc(options->threads * sizeof(thread_handle));
+    unsigned int worker_count = 0;
+    while (workers != NULL && worker_count < options->threads && thread_create(&workers[worker_count], pack_worker, &pool)) {
+        worker_count++;
+    }
+
+    // Write entries in order on this thread as they are loaded
+    int pack_status = 1;
+    for (size_t i = 0; i < entry_count && pack_status; i++) {
+        // Load entries on this thread if no workers could be started
+        if (worker_count == 0) {
+            entries[i].status = load_entry(folder_path, options, &entries[i], stats) ? 1 : -1;
+        }
+
+        mutex_lock(&pool.mutex);
+        while (entries[i].status == 0) {
+            condition_wait(&pool.entry_loaded, &pool.mutex);
+        }
+        mutex_unlock(&pool.mutex);
+
+        if (entries[i].status == 1) {
+            progress_message(progress, VERBOSITY_VERBOSE, "Adding %s to %s...\n", entries[i].filename, archive_path);
+            pack_status = write_entry(archive_pointer, &entries[i], stats);
+            if (pack_status) {
+                progress_advance(progress, entries[i].uncompressed_size);
+            }
+        } else {
+            pack_status = 0;
+        }
+        free(entries[i].data);
+        entries[i].data = NULL;
+
+        // Release memory, or stop workers on failure
+        mutex_lock(&pool.mutex);
+        pool.memory_used -= entries[i].cost;
+        pool.failed = !pack_status;
+        condition_broadcast(&pool.memory_released);
+        mutex_unlock(&pool.mutex);
+    }
+
+    for (unsigned int i = 0; i < worker_count; i++) {
+        thread_join(workers[i]);
+    }
+    stats_merge(options->stats, stats);
+    stats_buffer(options->stats, pool.peak_memory_used);
+    for (size_t i = 0; i < entry_count; i++) {
+        free(entries[i].data);
+    }
+    condition_destroy(&pool.entry_loaded);
+    condition_destroy(&pool.memory_released);
+    mutex_destroy(&pool.mutex);
+    free(workers);
+    return pack_status;
+}
+
+static int write_pack_index(const char *archive_path, const pack_entry *entries, const size_t entry_count) {
+    // Map the finished archive to find where each entry's data was written
+    file_mapping archive_mapping;
+    if (!map_file(&archive_mapping, archive_path, true)) {
+        return 0;
+    }
+    archive_index index;
+    int index_status = archive_index_build(&index, archive_mapping.data, archive_mapping.size) && index.entry_count == entry_count;
+
+    // Use the hashes taken while packing rather than decompressing every entry again
+    if (index_status) {
+        index.hashes = malloc(entry_count * sizeof(uint64_t));
+        index_status = index.hashes != NULL || entry_count == 0;
+    }
+    for (size_t i = 0; i < entry_count && index_status; i++) {
+        index.hashes[i] = entries[i].hash;
+    }
+    index_status = index_status && archive_index_save(&index, archive_path, archive_mapping.data);
+
+    archive_index_free(&index);
+    unmap_file(&archive_mapping);
+    return index_status;
+}
+
+static int pack_folder(const char *folder_path, const char *archive_path, const pack_options *options, progress_report *progress) {
+    // Ensure compression level is supported
+    if (!compress_supported(options->compression_level)) {
+        fprintf(stderr, "Unsupported compression level %d\n", options->compression_level);
+        return 0;
+    }
+
+    // Archives written to standard output have no index
+    const bool to_stdout = strcmp(archive_path, "-") == 0;
+    if (to_stdout && options->write_index) {
+        fprintf(stderr, "Cannot write an index for an archive written to standard output\n");
+        return 0;
+    }
+
+    // List files in folder
+    pack_entry *entries;
+    size_t entry_count;
+    stats_timer timer;
+    stats_start(options->stats, &timer);
+    const int list_status = list_folder(folder_path, options, progress, &entries, &entry_count);
+    stats_stop(options->stats, STATS_SCAN, &timer);
+    if (!list_status) {
+        return 0;
+    }
+
+    // Sort files into the order they will be packed in
+    stats_start(options->stats, &timer);
+    const int sort_status = sort_entries(entries, entry_count, options);
+    stats_stop(options->stats, STATS_SCAN, &timer);
+    if (!sort_status) {
+        free(entries);
+        return 0;
+    }
+
+    // Open archive
+    FILE *archive_pointer = NULL;
+    if (to_stdout) {
+        #ifdef _WIN32
+            _setmode(_fileno(stdout), _O_BINARY);
+        #endif
+        archive_pointer = stdout;
+    } else {
+        stats_start(options->stats, &timer);
+        archive_pointer = fopen(archive_path, "wb");
+        stats_calls(options->stats, STATS_OPEN, 1);
+        stats_stop(options->stats, STATS_WRITE, &timer);
+        if (archive_pointer == NULL) {
+            free(entries);
+            fprintf(stderr, "Error opening archive %s\n", archive_path);
+            return 0;
+        }
+    }
+
+    int pack_status = 1;
+    if (options->threads > 1) {
+        pack_status = pack_parallel(entries, entry_count, folder_path, archive_path, options, archive_pointer, progress);
+    } else {
+        // Add each file in turn, holding at most one compressed file in memory
+        for (size_t i = 0; i < entry_count && pack_status; i++) {
+            // Print current filename
+            progress_message(progress, VERBOSITY_VERBOSE, "Adding %s to %s...\n", entries[i].filename, archive_path);
+
+            if (options->compression_level == 0) {
+                pack_status = copy_entry(archive_pointer, folder_path, options, &entries[i], options->stats);
+            } else {
+                pack_status = load_entry(folder_path, options, &entries[i], options->stats) && write_entry(archive_pointer, &entries[i], options->stats);
+                free(entries[i].data);
+            }
+            if (pack_status) {
+                progress_advance(progress, entries[i].uncompressed_size);
+            }
+        }
+    }
+
+    // Write end of file byte to file
+    stats_start(options->stats, &timer);
+    const char eof_byte[1] = {'\0'};
+    pack_status = pack_status && fwrite(eof_byte, 1, 1, archive_pointer) == 1;
+    stats_calls(options->stats, STATS_WRITE_CALL, 1);
 
-    // Write end of file byte to file
-    const char eof_byte[1] = {'\0'};
-    fwrite(eof_byte, 1, 1, archive_pointer);
-
     // Close archive
-    fclose(archive_pointer);
+    if (to_stdout) {
+        pack_status = fflush(archive_pointer) == 0 && pack_status;
+    } else {
+        pack_status = fclose(archive_pointer) == 0 && pack_status;
+    }
+    stats_stop(options->stats, STATS_WRITE, &timer);
+    if (!pack_status) {
+        free(entries);
+        if (!to_stdout) {
+            archive_index_remove(archive_path);
+        }
+        return 0;
+    }
 
-    // Reached end, success
+    // Write sidecar index, or delete any left over from an earlier archive
+    if (options->write_index) {
+        progress_message(progress, VERBOSITY_PROGRESS, "Indexing %s...\n", archive_path);
+        pack_status = write_pack_index(archive_path, entries, entry_count);
+        if (!pack_status) {
+            fprintf(stderr, "Error writing index for archive %s\n", archive_path);
+        }
+    } else if (!to_stdout) {
+        archive_index_remove(archive_path);
+    }
+
+    // List the hashes taken while packing
+    if (pack_status && options->manifest_output_path != NULL) {
+        manifest_writer manifest;
+        pack_status = manifest_open(&manifest, options->manifest_output_path);
+        if (pack_status) {
+            manifest_begin_archive(&manifest, archive_path);
+            for (size_t i = 0; i < entry_count; i++) {
+                manifest_add(&manifest, entries[i].filename, entries[i].compression_level, entries[i].compressed_size, entries[i].uncompressed_size, entries[i].hash);
+            }
+            manifest_end_archive(&manifest);
+            pack_status = manifest_close(&manifest);
+        }
+        if (!pack_status) {
+            fprintf(stderr, "Error writing manifest %s\n", options->manifest_output_path);
+        }
+    }
+    free(entries);
+
+    return pack_status;
+}
+
+int pack(const char *folder_path, const char *archive_path, const pack_options *options) {
+    // Archives written to standard output have messages written to standard error instead
+    progress_report progress;
+    progress_begin(&progress, strcmp(archive_path, "-") == 0 ? stderr : stdout, options->message_level, "Packed");
+    stats_begin(options->stats);
+    const int pack_status = pack_folder(folder_path, archive_path, options, &progress);
+    stats_end(options->stats);
+    progress_end(&progress);
+    return pack_status;
+}
+
+static int recompress_entry(const archive_entry *entry, const pack_options *options, unsigned char **buffer, size_t *buffer_size, unsigned char **compressed_buffer, size_t *compressed_buffer_size, pack_entry *repacked) {
+    // Keep entries which cannot be decompressed as they are
+    if (entry->compression_level > 6) {
+        fprintf(stderr, "Unsupported run and offset length\n");
+        return 1;
+    }
+
+    // Grow buffers, which are reused between entries
+    const size_t bound = compress_bound(entry->uncompressed_size, options->compression_level);
+    if (bound > UINT32_MAX) {
+        return 1;
+    }
+    if (*buffer_size < entry->uncompressed_size) {
+        unsigned char *grown_buffer = realloc(*buffer, entry->uncompressed_size);
+        if (grown_buffer == NULL) {
+            fprintf(stderr, "Could not allocate memory for %s\n", entry->filename);
+            return 0;
+        }
+        *buffer = grown_buffer;
+        *buffer_size = entry->uncompressed_size;
+    }
+    if (*compressed_buffer_size < bound) {
+        unsigned char *grown_buffer = realloc(*compressed_buffer, bound);
+        if (grown_buffer == NULL) {
+            fprintf(stderr, "Could not allocate memory for %s\n", entry->filename);
+            return 0;
+        }
+        *compressed_buffer = grown_buffer;
+        *compressed_buffer_size = bound;
+    }
+
+    // Decompress data, keeping damaged entries as they are rather than losing what could not be decoded
+    const decompress_result result = archive_extract(entry, *buffer, *buffer_size);
+    if (result != DECOMPRESS_SUCCESS) {
+        report_result(entry, result);
+        return 1;
+    }
+
+    // Compress data, keeping the original if automatic compression could not improve on it
+    size_t compressed_size;
+    unsigned char compression_level = options->compression_level;
+    const int compress_status = options->compression_level == COMPRESSION_AUTO
+        ? compress_auto(*buffer, entry->uncompressed_size, *compressed_buffer, &compressed_size, &compression_level, options->effort)
+        : compress(*buffer, entry->uncompressed_size, *compressed_buffer, &compressed_size, options->compression_level, options->effort);
+    if (!compress_status) {
+        fprintf(stderr, "Error compressing file\n");
+        return 0;
+    }
+    if (options->compression_level == COMPRESSION_AUTO && compressed_size >= entry->compressed_size) {
+        return 1;
+    }
+    repacked->data = *compressed_buffer;
+    repacked->compressed_size = compressed_size;
+    repacked->compression_level = compression_level;
     return 1;
 }
+
+int repack(const char *source_path, const char *archive_path, const pack_options *options) {
+    // Ensure compression level is supported
+    if (options->compression_level != COMPRESSION_KEEP && !compress_supported(options->compression_level)) {
+        fprintf(stderr, "Unsupported compression level %d\n", options->compression_level);
+        return 0;
+    }
+
+    // Map source archive into memory
+    file_mapping source_mapping;
+    if (!map_file(&source_mapping, source_path, true)) {
+        fprintf(stderr, "Error opening archive %s\n", source_path);
+        return 0;
+    }
+
+    // Write to a temporary file first, so that an archive can be repacked in place
+    char *temporary_path = malloc(strlen(archive_path) + 5);
+    strcpy(temporary_path, archive_path);
+    strcat(temporary_path, ".tmp");
+    FILE *archive_pointer = NULL;
+    if ((archive_pointer = fopen(temporary_path, "wb")) == NULL) {
+        free(temporary_path);
+        unmap_file(&source_mapping);
+        fprintf(stderr, "Error opening archive %s\n", archive_path);
+        return 0;
+    }
+
+    // Copy each entry, recompressing only those not already at the requested compression level
+    progress_report progress;
+    progress_begin(&progress, stdout, options->message_level, "Repacked");
+    archive_reader reader;
+    archive_reader_open(&reader, source_mapping.data, source_mapping.size);
+    archive_entry entry;
+    unsigned char *buffer = NULL;
+    unsigned char *compressed_buffer = NULL;
+    size_t buffer_size = 0;
+    size_t compressed_buffer_size = 0;
+    int repack_status = 1;
+    int status;
+    while (repack_status && (status = archive_reader_next(&reader, &entry)) == 1) {
+        pack_entry repacked;
+        memset(&repacked, 0, sizeof(pack_entry));
+        strcpy(repacked.filename, entry.filename);
+        repacked.data = (unsigned char *) entry.data;
+        repacked.compressed_size = entry.compressed_size;
+        repacked.uncompressed_size = entry.uncompressed_size;
+        repacked.compression_level = entry.compression_level;
+        if (options->compression_level != COMPRESSION_KEEP && (options->compression_level == COMPRESSION_AUTO || entry.compression_level != options->compression_level)) {
+            progress_message(&progress, VERBOSITY_VERBOSE, "Recompressing %s to %s...\n", entry.filename, archive_path);
+            repack_status = recompress_entry(&entry, options, &buffer, &buffer_size, &compressed_buffer, &compressed_buffer_size, &repacked);
+        } else {
+            progress_message(&progress, VERBOSITY_VERBOSE, "Copying %s to %s...\n", entry.filename, archive_path);
+        }
+        repack_status = repack_status && write_entry(archive_pointer, &repacked, NULL);
+        if (repack_status) {
+            progress_advance(&progress, entry.uncompressed_size);
+        }
+    }
+    progress_end(&progress);
+    free(buffer);
+    free(compressed_buffer);
+    if (repack_status && status == -1) {
+        fprintf(stderr, "%s in archive %s\n", reader.error, source_path);
+        repack_status = 0;
+    }
+
+    // Write end of file byte to file
+    const char eof_byte[1] = {'\0'};
+    repack_status = repack_status && fwrite(eof_byte, 1, 1, archive_pointer) == 1;
+    repack_status = fclose(archive_pointer) == 0 && repack_status;
+    unmap_file(&source_mapping);
+
+    // Replace archive with temporary file
+    if (repack_status) {
+        #ifdef _WIN32
+            repack_status = MoveFileExA(temporary_path, archive_path, MOVEFILE_REPLACE_EXISTING);
+        #else
+            repack_status = rename(temporary_path, archive_path) == 0;
+        #endif
+        if (!repack_status) {
+            fprintf(stderr, "Error replacing archive %s\n", archive_path);
+        }
+    }
+    if (!repack_status) {
+        remove(temporary_path);
+    }
+    free(temporary_path);
+    if (!repack_status) {
+        return 0;
+    }
+
+    // Write sidecar index, or delete any left over from an earlier archive
+    if (options->write_index) {
+        return index_archive(archive_path, options->message_level);
+    }
+    archive_index_remove(archive_path);
+    return 1;
+}
+
+// Archive tails are moved through a buffer of this size when an entry changes size
+#define MOVE_BUFFER_SIZE (1 << 20)
+
+static int seek_file(FILE *file_pointer, const size_t offset) {
+    // Seek with 64-bit offsets, as long is only 32 bits on Windows
+    #ifdef _WIN32
+        return _fseeki64(file_pointer, (__int64) offset, SEEK_SET) == 0;
+    #else
+        return fseeko(file_pointer, (off_t) offset, SEEK_SET) == 0;
+    #endif
+}
+
+static int move_data(FILE *archive_pointer, const size_t source, const size_t end, const size_t destination) {
+    unsigned char *buffer = malloc(MOVE_BUFFER_SIZE);
+    if (buffer == NULL) {
+        return 0;
+    }
+
+    // Move blocks from the end when moving towards the end of the file, so that none are overwritten before being read
+    int move_status = 1;
+    for (size_t moved_size = 0; moved_size < end - source && move_status;) {
+        const size_t block_size = end - source - moved_size < MOVE_BUFFER_SIZE ? end - source - moved_size : MOVE_BUFFER_SIZE;
+        const size_t block_offset = destination > source ? end - source - moved_size - block_size : moved_size;
+        move_status = seek_file(archive_pointer, source + block_offset)
+            && fread(buffer, block_size, 1, archive_pointer) == 1
+            && seek_file(archive_pointer, destination + block_offset)
+            && fwrite(buffer, block_size, 1, archive_pointer) == 1;
+        moved_size += block_size;
+    }
+    free(buffer);
+    return move_status;
+}
+
+static int truncate_file(FILE *file_pointer, const size_t size) {
+    if (fflush(file_pointer) != 0) {
+        return 0;
+    }
+    #ifdef _WIN32
+        return _chsize_s(_fileno(file_pointer), (__int64) size) == 0;
+    #else
+        return ftruncate(fileno(file_pointer), (off_t) size) == 0;
+    #endif
+}
+
+static int update_entry(const char *archive_path, const update_type type, const char *file_path, const pack_options *options, const bool required, progress_report *progress) {
+    // Split path into folder and filename
+    const char *filename = strrchr(file_path, '/') ? strrchr(file_path, '/') + 1 : file_path;
+    #ifdef _WIN32
+        filename = strrchr(filename, '\\') ? strrchr(filename, '\\') + 1 : filename;
+    #endif
+    if (!valid_filename(filename)) {
+        fprintf(stderr, "Invalid filename %s\n", filename);
+        return 0;
+    }
+
+    // Read and compress new file
+    pack_entry new_entry;
+    memset(&new_entry, 0, sizeof(pack_entry));
+    strcpy(new_entry.filename, filename);
+    if (type != UPDATE_DELETE) {
+        const size_t folder_size = filename - file_path;
+        char *folder_path = malloc(folder_size + 2);
+        if (folder_size == 0) {
+            strcpy(folder_path, ".");
+        } else {
+            memcpy(folder_path, file_path, folder_size - 1);
+            folder_path[folder_size - 1] = '\0';
+        }
+        const int load_status = load_entry(folder_path, options, &new_entry, NULL);
+        free(folder_path);
+        if (!load_status) {
+            free(new_entry.data);
+            return 0;
+        }
+    }
+
+    // Index archive, refusing to change a malformed archive
+    file_mapping archive_mapping;
+    if (!map_file(&archive_mapping, archive_path, false)) {
+        free(new_entry.data);
+        fprintf(stderr, "Error opening archive %s\n", archive_path);
+        return 0;
+    }
+    archive_index index;
+    if (!archive_index_build(&index, archive_mapping.data, archive_mapping.size)) {
+        fprintf(stderr, "%s in archive %s\n", index.error, archive_path);
+        archive_index_free(&index);
+        unmap_file(&archive_mapping);
+        free(new_entry.data);
+        return 0;
+    }
+
+    // Find the bytes the entry occupies, which are empty before the end of file byte when adding
+    const archive_entry *entry = archive_index_find(&index, filename);
+    size_t entry_start = archive_mapping.size - 1;
+    size_t old_entry_size = 0;
+    uint64_t changed_size = new_entry.uncompressed_size;
+    int find_status = 1;
+    if (type == UPDATE_ADD && entry != NULL) {
+        fprintf(stderr, "%s is already in archive %s\n", filename, archive_path);
+        find_status = 0;
+    } else if (type != UPDATE_ADD && entry == NULL) {
+        if (required) {
+            fprintf(stderr, "Could not find %s in archive %s\n", filename, archive_path);
+        }
+        find_status = required ? 0 : -1;
+    } else if (entry != NULL) {
+        // Keep the filename's case as it is in the archive
+        strcpy(new_entry.filename, entry->filename);
+        old_entry_size = strlen(entry->filename) + 1 + HEADER_SIZE + entry->compressed_size;
+        entry_start = entry->data + entry->compressed_size - archive_mapping.data - old_entry_size;
+        if (type == UPDATE_DELETE) {
+            changed_size = entry->uncompressed_size;
+        }
+    }
+    const size_t archive_size = archive_mapping.size;
+    archive_index_free(&index);
+    unmap_file(&archive_mapping);
+    if (find_status != 1) {
+        free(new_entry.data);
+        return find_status;
+    }
+
+    // Print current filename
+    if (type == UPDATE_ADD) {
+        progress_message(progress, VERBOSITY_VERBOSE, "Adding %s to %s...\n", new_entry.filename, archive_path);
+    } else if (type == UPDATE_REPLACE) {
+        progress_message(progress, VERBOSITY_VERBOSE, "Replacing %s in %s...\n", new_entry.filename, archive_path);
+    } else {
+        progress_message(progress, VERBOSITY_VERBOSE, "Deleting %s from %s...\n", new_entry.filename, archive_path);
+    }
+
+    // Move the rest of the archive if the entry changes size, so that it can be written in place
+    FILE *archive_pointer = fopen(archive_path, "r+b");
+    if (archive_pointer == NULL) {
+        free(new_entry.data);
+        fprintf(stderr, "Error opening archive %s\n", archive_path);
+        return 0;
+    }
+    const size_t new_entry_size = type == UPDATE_DELETE ? 0 : strlen(new_entry.filename) + 1 + HEADER_SIZE + new_entry.compressed_size;
+    const size_t tail_start = entry_start + old_entry_size;
+    int update_status = new_entry_size == old_entry_size || move_data(archive_pointer, tail_start, archive_size, entry_start + new_entry_size);
+    if (update_status && type != UPDATE_DELETE) {
+        update_status = seek_file(archive_pointer, entry_start) && write_entry(archive_pointer, &new_entry, NULL);
+    }
+    if (update_status && new_entry_size < old_entry_size) {
+        update_status = truncate_file(archive_pointer, archive_size - (old_entry_size - new_entry_size));
+    }
+    update_status = fclose(archive_pointer) == 0 && update_status;
+    free(new_entry.data);
+    if (!update_status) {
+        fprintf(stderr, "Error updating archive %s\n", archive_path);
+        return 0;
+    }
+    progress_advance(progress, changed_size);
+    return 1;
+}
+
+int update(const char *archive_path, const update_type type, const char **file_paths, const size_t file_count, const pack_options *options) {
+    // Ensure compression level is supported
+    if (type != UPDATE_DELETE && !compress_supported(options->compression_level)) {
+        fprintf(stderr, "Unsupported compression level %d\n", options->compression_level);
+        return 0;
+    }
+
+    // Change each entry in turn, deleting every entry with a filename so that none which it overwrote reappear
+    progress_report progress;
+    progress_begin(&progress, stdout, options->message_level, type == UPDATE_ADD ? "Added" : type == UPDATE_REPLACE ? "Replaced" : "Deleted");
+    int update_status = 1;
+    for (size_t i = 0; i < file_count && update_status; i++) {
+        update_status = update_entry(archive_path, type, file_paths[i], options, true, &progress);
+        while (update_status == 1 && type == UPDATE_DELETE) {
+            update_status = update_entry(archive_path, type, file_paths[i], options, false, &progress);
+        }
+        if (update_status == -1) {
+            update_status = 1;
+        }
+    }
+    progress_end(&progress);
+
+    // Write sidecar index, or delete the one made stale by the changes
+    if (update_status && options->write_index) {
+        return index_archive(archive_path, options->message_level);
+    }
+    archive_index_remove(archive_path);
+    return update_status;
+}
@@ -0,0 +1,347 @@
+/*
+ * Red Archive
+ * MIT License
+ * Copyright (c) 2020 Jacob Gelling
+ */
+
+#include "bench.h"
+
+typedef struct {
+    unsigned int iterations;
+    unsigned int warmup;
+    size_t corpus_size;
+    compress_effort effort;
+} bench_options;
+
+// Timings summarised for each measurement
+typedef struct {
+    double median;
+    double p99;
+} bench_timing;
+
+typedef enum {
+    CORPUS_RANDOM,
+    CORPUS_ZERO,
+    CORPUS_TEXT,
+    CORPUS_SPRITE,
+    CORPUS_COUNT
+} corpus_type;
+
+static const char *corpus_names[CORPUS_COUNT] = {"random", "zero", "text", "sprite"};
+
+static uint32_t next_random(uint32_t *state) {
+    // Xorshift, so corpora are the same on every run and platform
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+static void make_corpus(const corpus_type type, unsigned char *data, const size_t size) {
+    static const char *words[] = {"the", "car", "track", "race", "lap", "wheel", "engine", "driver", "turn", "fast", "red", "dirt", "road", "of", "and", "a"};
+    uint32_t state = 2020;
+    size_t position = 0;
+
+    switch (type) {
+        case CORPUS_RANDOM:
+            for (; position < size; position++) {
+                data[position] = next_random(&state);
+            }
+            break;
+
+        case CORPUS_ZERO:
+            memset(data, 0, size);
+            break;
+
+        // Words from a small vocabulary separated by spaces and line breaks
+        case CORPUS_TEXT:
+            while (position < size) {
+                const char *word = words[next_random(&state) % (sizeof(words) / sizeof(words[0]))];
+                for (size_t i = 0; word[i] != '\0' && position < size; i++) {
+                    data[position++] = word[i];
+                }
+                if (position < size) {
+                    data[position++] = next_random(&state) % 12 == 0 ? '\n' : ' ';
+                }
+            }
+            break;
+
+        // Rows of 64 palette indices made of runs, mostly repeating the row above with a few changes
+        case CORPUS_SPRITE:
+            while (position < size) {
+                if (position >= 64 && next_random(&state) % 4 != 0) {
+                    for (size_t i = 0; i < 64 && position < size; i++, position++) {
+                        data[position] = next_random(&state) % 16 == 0 ? next_random(&state) : data[position - 64];
+                    }
+                } else {
+                    for (size_t i = 0; i < 64 && position < size;) {
+                        const unsigned char colour = next_random(&state) % 3 == 0 ? 0 : next_random(&state);
+                        for (size_t run = 1 + next_random(&state) % 12; run > 0 && i < 64 && position < size; run--, i++) {
+                            data[position++] = colour;
+                        }
+                    }
+                }
+            }
+            break;
+
+        case CORPUS_COUNT:
+            break;
+    }
+}
+
+static int compare_times(const void *first, const void *second) {
+    const double first_time = *(const double *) first;
+    const double second_time = *(const double *) second;
+    return (first_time > second_time) - (first_time < second_time);
+}
+
+static bench_timing summarise(double *times, const unsigned int count) {
+    // Take the median and the time which 99% of iterations beat or match
+    qsort(times, count, sizeof(double), compare_times);
+    const bench_timing timing = {times[count / 2], times[(count * 99 + 99) / 100 - 1]};
+    return timing;
+}
+
+static void print_header(const char *source_title) {
+    printf("%-12s %4s %7s %12s %12s %10s %14s\n", source_title, "type", "ratio", "encode MB/s", "decode MB/s", "ns/byte", "p99 ns/byte");
+}
+
+static void print_row(const char *source, const unsigned char compression_level, const size_t compressed_size, const size_t uncompressed_size, const bench_timing *encode, const bench_timing *decode) {
+    const double ratio = uncompressed_size ? 100.0 * compressed_size / uncompressed_size : 100.0;
+    char encode_speed[16] = "-";
+    if (encode != NULL) {
+        snprintf(encode_speed, sizeof(encode_speed), "%.1f", uncompressed_size / encode->median / 1e6);
+    }
+    printf("%-12s %4d %6.1f%% %12s %12.1f %10.3f %14.3f\n", source, compression_level, ratio, encode_speed,
+        uncompressed_size / decode->median / 1e6, decode->median * 1e9 / uncompressed_size, decode->p99 * 1e9 / uncompressed_size);
+}
+
+static int bench_corpus(const corpus_type type, const bench_options *options, double *times) {
+    // Create corpus and buffers for its compressed and decompressed data
+    unsigned char *data = malloc(options->corpus_size);
+    unsigned char *compressed_data = malloc(compress_bound(options->corpus_size, COMPRESSION_AUTO));
+    unsigned char *decompressed_data = malloc(options->corpus_size);
+    if (data == NULL || compressed_data == NULL || decompressed_data == NULL) {
+        free(data);
+        free(compressed_data);
+        free(decompressed_data);
+        fprintf(stderr, "Could not allocate memory for corpus\n");
+        return 0;
+    }
+    make_corpus(type, data, options->corpus_size);
+
+    int bench_status = 1;
+    for (unsigned char compression_level = 0; compression_level <= 6 && bench_status; compression_level++) {
+        // Time compression
+        size_t compressed_size = 0;
+        for (unsigned int i = 0; i < options->warmup + options->iterations && bench_status; i++) {
+            const double start_time = stats_wall_time();
+            bench_status = compress(data, options->corpus_size, compressed_data, &compressed_size, compression_level, options->effort);
+            if (i >= options->warmup) {
+                times[i - options->warmup] = stats_wall_time() - start_time;
+            }
+        }
+        if (!bench_status) {
+            fprintf(stderr, "Could not compress %s corpus at type %d\n", corpus_names[type], compression_level);
+            break;
+        }
+        const bench_timing encode = summarise(times, options->iterations);
+
+        // Time decompression, checking that it reproduces the corpus
+        for (unsigned int i = 0; i < options->warmup + options->iterations; i++) {
+            const double start_time = stats_wall_time();
+            const decompress_result result = decompress(compressed_data, compressed_size, decompressed_data, options->corpus_size, compression_level);
+            if (i >= options->warmup) {
+                times[i - options->warmup] = stats_wall_time() - start_time;
+            }
+            bench_status = bench_status && result == DECOMPRESS_SUCCESS;
+        }
+        if (!bench_status || memcmp(data, decompressed_data, options->corpus_size) != 0) {
+            fprintf(stderr, "Could not decompress %s corpus at type %d\n", corpus_names[type], compression_level);
+            bench_status = 0;
+            break;
+        }
+        const bench_timing decode = summarise(times, options->iterations);
+
+        print_row(corpus_names[type], compression_level, compressed_size, options->corpus_size, &encode, &decode);
+    }
+
+    free(data);
+    free(compressed_data);
+    free(decompressed_data);
+    return bench_status;
+}
+
+static int bench_archive(const char *archive_path, const bench_options *options, double *times) {
+    // Map and index archive
+    file_mapping archive_mapping;
+    if (!map_file(&archive_mapping, archive_path, true)) {
+        fprintf(stderr, "Error opening archive %s\n", archive_path);
+        return 0;
+    }
+    archive_index index;
+    if (!archive_index_build(&index, archive_mapping.data, archive_mapping.size)) {
+        fprintf(stderr, "%s in archive %s\n", index.error, archive_path);
+        archive_index_free(&index);
+        unmap_file(&archive_mapping);
+        return 0;
+    }
+
+    // Find the largest entry, whose buffer is used for every entry
+    size_t buffer_size = 0;
+    for (size_t i = 0; i < index.entry_count; i++) {
+        if (index.entries[i].uncompressed_size > buffer_size) {
+            buffer_size = index.entries[i].uncompressed_size;
+        }
+    }
+    unsigned char *buffer = malloc(buffer_size ? buffer_size : 1);
+    if (buffer == NULL) {
+        fprintf(stderr, "Could not allocate memory for %s\n", archive_path);
+        archive_index_free(&index);
+        unmap_file(&archive_mapping);
+        return 0;
+    }
+
+    // Time decompression of all entries of each compression level in turn
+    const char *filename = strrchr(archive_path, '/') ? strrchr(archive_path, '/') + 1 : archive_path;
+    for (unsigned char compression_level = 0; compression_level <= 6; compression_level++) {
+        size_t compressed_size = 0;
+        size_t uncompressed_size = 0;
+        for (size_t i = 0; i < index.entry_count; i++) {
+            if (index.entries[i].compression_level == compression_level) {
+                compressed_size += index.entries[i].compressed_size;
+                uncompressed_size += index.entries[i].uncompressed_size;
+            }
+        }
+        if (uncompressed_size == 0) {
+            continue;
+        }
+
+        for (unsigned int i = 0; i < options->warmup + options->iterations; i++) {
+            const double start_time = stats_wall_time();
+            for (size_t j = 0; j < index.entry_count; j++) {
+                if (index.entries[j].compression_level == compression_level) {
+                    archive_extract(&index.entries[j], buffer, buffer_size);
+                }
+            }
+            if (i >= options->warmup) {
+                times[i - options->warmup] = stats_wall_time() - start_time;
+            }
+        }
+        const bench_timing decode = summarise(times, options->iterations);
+
+        print_row(filename, compression_level, compressed_size, uncompressed_size, NULL, &decode);
+    }
+
+    free(buffer);
+    archive_index_free(&index);
+    unmap_file(&archive_mapping);
+    return 1;
+}
+
+static int parse_number(const char *text, const long minimum, const long maximum, long *value) {
+    char *end;
+    *value = strtol(text, &end, 10);
+    return *text != '\0' && *end == '\0' && *value >= minimum && *value <= maximum;
+}
+
+static void print_usage(const char *program) {
+    printf("Red Archive Benchmark %d.%d\n", REDARCHIVE_VERSION_MAJOR, REDARCHIVE_VERSION_MINOR);
+    printf("MIT License\n");
+    printf("Copyright (c) 2020 Jacob Gelling\n\n");
+    printf("  To benchmark every compression type on synthetic data and decompression of any archives given:\n");
+    printf("  %s [options] [archive...]\n\n", program);
+    printf("  Options:\n");
+    printf("  -i, --iterations count   Timed iterations of each measurement (default 20)\n");
+    printf("  -w, --warmup count       Untimed iterations before each measurement (default 3)\n");
+    printf("  -s, --size kilobytes     Size of each synthetic corpus (default 1024)\n");
+    printf("  -e, --effort effort      Compression effort for types 2-6 (fast, lazy or optimal, default lazy)\n");
+    printf("  -n, --no-corpora         Only benchmark the archives given\n");
+}
+
+int main(const int argc, char *argv[]) {
+    // Parse options, leaving archives in place
+    bench_options options = {20, 3, 1024 << 10, COMPRESS_LAZY};
+    bool corpora = true;
+    const char **archive_paths = malloc(argc * sizeof(char *));
+    int archive_count = 0;
+    for (int i = 1; i < argc; i++) {
+        long value;
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            free(archive_paths);
+            return EXIT_SUCCESS;
+        } else if (strcmp(argv[i], "-i") == 0 || strcmp(argv[i], "--iterations") == 0) {
+            if (i + 1 == argc || !parse_number(argv[i + 1], 1, 100000, &value)) {
+                fprintf(stderr, "Invalid number of iterations for %s\n", argv[i]);
+                free(archive_paths);
+                return EXIT_FAILURE;
+            }
+            options.iterations = value;
+            i++;
+        } else if (strcmp(argv[i], "-w") == 0 || strcmp(argv[i], "--warmup") == 0) {
+            if (i + 1 == argc || !parse_number(argv[i + 1], 0, 100000, &value)) {
+                fprintf(stderr, "Invalid number of warmup iterations for %s\n", argv[i]);
+                free(archive_paths);
+                return EXIT_FAILURE;
+            }
+            options.warmup = value;
+            i++;
+        } else if (strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "--size") == 0) {
+            if (i + 1 == argc || !parse_number(argv[i + 1], 1, 1048576, &value)) {
+                fprintf(stderr, "Invalid corpus size for %s\n", argv[i]);
+                free(archive_paths);
+                return EXIT_FAILURE;
+            }
+            options.corpus_size = (size_t) value << 10;
+            i++;
+        } else if (strcmp(argv[i], "-e") == 0 || strcmp(argv[i], "--effort") == 0) {
+            const char *effort = i + 1 < argc ? argv[i + 1] : "";
+            if (strcmp(effort, "fast") == 0) {
+                options.effort = COMPRESS_FAST;
+            } else if (strcmp(effort, "lazy") == 0) {
+                options.effort = COMPRESS_LAZY;
+            } else if (strcmp(effort, "optimal") == 0) {
+                options.effort = COMPRESS_OPTIMAL;
+            } else {
+                fprintf(stderr, "Invalid compression effort for %s\n", argv[i]);
+                free(archive_paths);
+                return EXIT_FAILURE;
+            }
+            i++;
+        } else if (strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--no-corpora") == 0) {
+            corpora = false;
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            free(archive_paths);
+            return EXIT_FAILURE;
+        } else {
+            archive_paths[archive_count++] = argv[i];
+        }
+    }
+
+    double *times = malloc(options.iterations * sizeof(double));
+    int status = times != NULL;
+
+    // Benchmark compression and decompression of each synthetic corpus
+    if (corpora && status) {
+        printf("Synthetic corpora of %zu bytes, %u iterations after %u warmup\n", options.corpus_size, options.iterations, options.warmup);
+        print_header("corpus");
+        for (corpus_type type = 0; type < CORPUS_COUNT && status; type++) {
+            status = bench_corpus(type, &options, times);
+        }
+    }
+
+    // Benchmark decompression of each archive
+    if (archive_count > 0 && status) {
+        printf("%sArchives, %u iterations after %u warmup\n", corpora ? "\n" : "", options.iterations, options.warmup);
+        print_header("archive");
+        for (int i = 0; i < archive_count && status; i++) {
+            status = bench_archive(archive_paths[i], &options, times);
+        }
+    }
+
+    free(times);
+    free(archive_paths);
+    return status ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -6,40 +6,292 @@
 
 #include "cli.h"
 
+typedef enum {
+    COMMAND_UNPACK,
+    COMMAND_BATCH,
+    COMMAND_TEST,
+    COMMAND_PACK,
+    COMMAND_EXTRACT,
+    COMMAND_INDEX,
+    COMMAND_REPACK,
+    COMMAND_ADD,
+    COMMAND_REPLACE,
+    COMMAND_DELETE,
+    COMMAND_COUNT
+} command_type;
+
+// Formats statistics can be printed in
+typedef enum {
+    STATS_NONE,
+    STATS_TEXT,
+    STATS_JSON
+} stats_format;
+
+// Names and number of arguments taken by each command
+static const struct {
+    const char *short_name;
+    const char *long_name;
+    int minimum_arguments;
+    int maximum_arguments;
+} commands[COMMAND_COUNT] = {
+    {"-u", "--unpack", 2, 2},
+    {"-b", "--batch", 2, INT_MAX},
+    {"-t", "--test", 1, INT_MAX},
+    {"-p", "--pack", 2, 2},
+    {"-x", "--extract", 2, INT_MAX},
+    {"-i", "--index", 1, 1},
+    {"-r", "--repack", 2, 2},
+    {"-a", "--add", 2, INT_MAX},
+    {"-R", "--replace", 2, INT_MAX},
+    {"-d", "--delete", 2, INT_MAX}
+};
+
+static void print_usage(const char *program) {
+    printf("Red Archive %d.%d\n", REDARCHIVE_VERSION_MAJOR, REDARCHIVE_VERSION_MINOR);
+    printf("MIT License\n");
+    printf("Copyright (c) 2020 Jacob Gelling\n\n");
+    printf("  To unpack an archive into a folder:\n");
+    printf("  %s -u archive folder\n\n", program);
+    printf("  To unpack many archives, or lists of archives given as @file, each into a folder named after it:\n");
+    printf("  %s -b folder archive...\n\n", program);
+    printf("  To test archives, or lists of archives given as @file, by decoding every file without writing it:\n");
+    printf("  %s -t archive...\n\n", program);
+    printf("  To pack a folder into an archive:\n");
+    printf("  %s -p folder archive\n\n", program);
+    printf("  To extract files from an archive into the current folder:\n");
+    printf("  %s -x archive filename...\n\n", program);
+    printf("  To write a sidecar index which lets an archive be opened without reading it:\n");
+    printf("  %s -i archive\n\n", program);
+    printf("  To repack an archive into another, or itself, recompressing files only if -c is given:\n");
+    printf("  %s -r archive archive\n\n", program);
+    printf("  To add files to, replace files in or delete files from an archive in place:\n");
+    printf("  %s -a archive file...\n", program);
+    printf("  %s -R archive file...\n", program);
+    printf("  %s -d archive filename...\n\n", program);
+    printf("  Options:\n");
+    printf("  -c, --compression level  Compression type to pack files with (0-6 or auto, default 0)\n");
+    printf("  -e, --effort effort      Compression effort for types 2-6 (fast, lazy or optimal, default lazy)\n");
+    printf("  -j, --jobs threads       Number of threads to unpack or pack with (default 1)\n");
+    printf("  -m, --memory megabytes   Memory for files being packed in parallel (default 256)\n");
+    printf("  -s, --sidecar            Write a sidecar index after unpacking, testing or packing\n");
+    printf("  -o, --order order        Order to pack files in (folder, name, type or a manifest, default folder)\n");
+    printf("  -q, --quiet              Print only errors\n");
+    printf("  -v, --verbose            Print each file as it is unpacked or packed, rather than a progress line\n");
+    printf("  --stats                  Print time, data and file operations for each phase of unpacking, extracting or packing\n");
+    printf("  --stats-json             Print the same statistics as JSON\n");
+    printf("  --manifest file          Write the XXH64 hash of every file unpacked, tested or packed to a JSON file\n");
+}
+
+static int parse_number(const char *text, const long minimum, const long maximum, long *value) {
+    char *end;
+    *value = strtol(text, &end, 10);
+    return *text != '\0' && *end == '\0' && *value >= minimum && *value <= maximum;
+}
+
 int main(const int argc, char *argv[]) {
-    switch (argc) {
-        // No arguments provided
-        case 1:
-            printf("Red Archive %d.%d\n", REDARCHIVE_VERSION_MAJOR, REDARCHIVE_VERSION_MINOR);
-            printf("MIT License\n");
-            printf("Copyright (c) 2020 Jacob Gelling\n\n");
-            printf("  To unpack an archive into a folder:\n");
-            printf("  %s -u archive folder\n\n", argv[0]);
-            printf("  To pack a folder into an archive:\n");
-            printf("  %s -p folder archive\n", argv[0]);
-            break;
-
-        // Correct number of arguments provided
-        case 4:
-            if (strcmp(argv[1], "-u") == 0 || strcmp(argv[1], "--unpack") == 0) {
-                if (unpack(argv[2], argv[3]) != 1) {
-                    return EXIT_FAILURE;
-                }
-            } else if (strcmp(argv[1], "-p") == 0 || strcmp(argv[1], "--pack") == 0) {
-                if (pack(argv[2], argv[3]) != 1) {
-                    return EXIT_FAILURE;
-                }
+    // No arguments provided
+    if (argc == 1) {
+        print_usage(argv[0]);
+        return EXIT_SUCCESS;
+    }
+
+    // Parse command, options and remaining arguments
+    command_type command = COMMAND_COUNT;
+    const char **arguments = malloc(argc * sizeof(char *));
+    int argument_count = 0;
+    long compression_level = 0;
+    bool compression_given = false;
+    compress_effort effort = COMPRESS_LAZY;
+    long threads = 1;
+    long memory_budget = 256;
+    bool write_index = false;
+    pack_order order = PACK_ORDER_FOLDER;
+    const char *manifest_path = NULL;
+    const char *manifest_output_path = NULL;
+    stats_format stats_output = STATS_NONE;
+    verbosity message_level = VERBOSITY_PROGRESS;
+    for (int i = 1; i < argc; i++) {
+        // Find command
+        command_type argument_command = 0;
+        while (argument_command < COMMAND_COUNT && strcmp(argv[i], commands[argument_command].short_name) != 0 && strcmp(argv[i], commands[argument_command].long_name) != 0) {
+            argument_command++;
+        }
+
+        if (argument_command < COMMAND_COUNT) {
+            if (command != COMMAND_COUNT) {
+                fprintf(stderr, "Only one command may be given\n");
+                free(arguments);
+                return EXIT_FAILURE;
+            }
+            command = argument_command;
+        } else if (strcmp(argv[i], "-c") == 0 || strcmp(argv[i], "--compression") == 0) {
+            if (i + 1 < argc && strcmp(argv[i + 1], "auto") == 0) {
+                compression_level = COMPRESSION_AUTO;
+            } else if (i + 1 == argc || !parse_number(argv[i + 1], 0, 6, &compression_level)) {
+                fprintf(stderr, "Invalid compression level for %s\n", argv[i]);
+                free(arguments);
+                return EXIT_FAILURE;
+            }
+            compression_given = true;
+            i++;
+        } else if (strcmp(argv[i], "-e") == 0 || strcmp(argv[i], "--effort") == 0) {
+            const char *value = i + 1 < argc ? argv[i + 1] : "";
+            if (strcmp(value, "fast") == 0) {
+                effort = COMPRESS_FAST;
+            } else if (strcmp(value, "lazy") == 0) {
+                effort = COMPRESS_LAZY;
+            } else if (strcmp(value, "optimal") == 0) {
+                effort = COMPRESS_OPTIMAL;
+            } else {
+                fprintf(stderr, "Invalid compression effort for %s\n", argv[i]);
+                free(arguments);
+                return EXIT_FAILURE;
+            }
+            i++;
+        } else if (strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--jobs") == 0) {
+            if (i + 1 == argc || !parse_number(argv[i + 1], 1, 1024, &threads)) {
+                fprintf(stderr, "Invalid number of threads for %s\n", argv[i]);
+                free(arguments);
+                return EXIT_FAILURE;
+            }
+            i++;
+        } else if (strcmp(argv[i], "-m") == 0 || strcmp(argv[i], "--memory") == 0) {
+            if (i + 1 == argc || !parse_number(argv[i + 1], 1, 1048576, &memory_budget)) {
+                fprintf(stderr, "Invalid memory budget for %s\n", argv[i]);
+                free(arguments);
+                return EXIT_FAILURE;
+            }
+            i++;
+        } else if (strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--order") == 0) {
+            const char *value = i + 1 < argc ? argv[i + 1] : "";
+            if (strcmp(value, "folder") == 0) {
+                order = PACK_ORDER_FOLDER;
+            } else if (strcmp(value, "name") == 0) {
+                order = PACK_ORDER_NAME;
+            } else if (strcmp(value, "type") == 0) {
+                order = PACK_ORDER_TYPE;
+            } else if (*value != '\0') {
+                order = PACK_ORDER_MANIFEST;
+                manifest_path = value;
             } else {
-                fprintf(stderr, "Unknown option %s\n", argv[1]);
+                fprintf(stderr, "Invalid order for %s\n", argv[i]);
+                free(arguments);
+                return EXIT_FAILURE;
+            }
+            i++;
+        } else if (strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "--sidecar") == 0) {
+            write_index = true;
+        } else if (strcmp(argv[i], "-q") == 0 || strcmp(argv[i], "--quiet") == 0) {
+            message_level = VERBOSITY_QUIET;
+        } else if (strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--verbose") == 0) {
+            message_level = VERBOSITY_VERBOSE;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            stats_output = STATS_TEXT;
+        } else if (strcmp(argv[i], "--stats-json") == 0) {
+            stats_output = STATS_JSON;
+        } else if (strcmp(argv[i], "--manifest") == 0) {
+            if (i + 1 == argc || argv[i + 1][0] == '\0') {
+                fprintf(stderr, "Invalid manifest file for %s\n", argv[i]);
+                free(arguments);
                 return EXIT_FAILURE;
             }
+            manifest_output_path = argv[++i];
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            free(arguments);
+            return EXIT_FAILURE;
+        } else {
+            arguments[argument_count++] = argv[i];
+        }
+    }
+
+    // Ensure a command and correct number of arguments are provided
+    if (command == COMMAND_COUNT || argument_count < commands[command].minimum_arguments || argument_count > commands[command].maximum_arguments) {
+        fprintf(stderr, "Incorrect number of arguments\n");
+        free(arguments);
+        return EXIT_FAILURE;
+    }
+
+    // Statistics are gathered for unpacking, extracting and packing
+    if (stats_output != STATS_NONE && command != COMMAND_UNPACK && command != COMMAND_BATCH && command != COMMAND_TEST && command != COMMAND_EXTRACT && command != COMMAND_PACK) {
+        fprintf(stderr, "Statistics are only available when unpacking, testing, extracting or packing\n");
+        free(arguments);
+        return EXIT_FAILURE;
+    }
+    archive_stats run_stats;
+    archive_stats *stats = stats_output != STATS_NONE ? &run_stats : NULL;
+
+    // Hashes are listed for the same commands, which decode or read every file
+    if (manifest_output_path != NULL && command != COMMAND_UNPACK && command != COMMAND_BATCH && command != COMMAND_TEST && command != COMMAND_PACK) {
+        fprintf(stderr, "Manifests are only available when unpacking, testing or packing\n");
+        free(arguments);
+        return EXIT_FAILURE;
+    }
+
+    // Run command
+    int status = 0;
+    switch (command) {
+        case COMMAND_UNPACK: {
+            const unpack_options options = {threads, write_index, manifest_output_path, stats, message_level};
+            status = unpack(arguments[0], arguments[1], &options);
             break;
+        }
 
-        // Incorrect number of arguments provided
-        default:
-            fprintf(stderr, "Incorrect number of arguments\n");
-            return EXIT_FAILURE;
+        case COMMAND_BATCH: {
+            const unpack_options options = {threads, write_index, manifest_output_path, stats, message_level};
+            status = unpack_batch(&arguments[1], argument_count - 1, arguments[0], &options);
+            break;
+        }
+
+        case COMMAND_TEST: {
+            const unpack_options options = {threads, write_index, manifest_output_path, stats, message_level};
+            status = test_archives(arguments, argument_count, &options);
+            break;
+        }
+
+        case COMMAND_PACK: {
+            const pack_options options = {compression_level, effort, threads, (size_t) memory_budget << 20, write_index, order, manifest_path, stats, message_level, manifest_output_path};
+            status = pack(arguments[0], arguments[1], &options);
+            break;
+        }
+
+        case COMMAND_EXTRACT:
+            status = extract(arguments[0], ".", &arguments[1], argument_count - 1, message_level, stats);
+            break;
+
+        case COMMAND_REPACK: {
+            const pack_options options = {compression_given ? compression_level : COMPRESSION_KEEP, effort, threads, (size_t) memory_budget << 20, write_index, PACK_ORDER_FOLDER, NULL, NULL, message_level, NULL};
+            status = repack(arguments[0], arguments[1], &options);
+            break;
+        }
+
+        case COMMAND_ADD:
+        case COMMAND_REPLACE:
+        case COMMAND_DELETE: {
+            const pack_options options = {compression_level, effort, threads, (size_t) memory_budget << 20, write_index, PACK_ORDER_FOLDER, NULL, NULL, message_level, NULL};
+            const update_type type = command == COMMAND_ADD ? UPDATE_ADD : command == COMMAND_REPLACE ? UPDATE_REPLACE : UPDATE_DELETE;
+            status = update(arguments[0], type, &arguments[1], argument_count - 1, &options);
+            break;
+        }
+
+        case COMMAND_INDEX:
+            status = index_archive(arguments[0], message_level);
+            break;
+
+        case COMMAND_COUNT:
+            break;
+    }
+
+    // Print statistics, to standard error if an archive was written to standard output
+    if (stats != NULL) {
+        FILE *stats_pointer = command == COMMAND_PACK && strcmp(arguments[1], "-") == 0 ? stderr : stdout;
+        if (stats_output == STATS_JSON) {
+            stats_print_json(stats, stats_pointer);
+        } else {
+            stats_print(stats, stats_pointer);
+        }
     }
+    free(arguments);
 
-    return EXIT_SUCCESS;
+    return status == 1 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -0,0 +1,405 @@
+/*
+ * Red Archive
+ * MIT License
+ * Copyright (c) 2020 Jacob Gelling
+ */
+
+#include "compress.h"
+
+// Type 1 runs are 1 to 128 literal bytes or 3 to 130 repeated bytes
+#define TYPE_1_MAX_LITERAL 128
+#define TYPE_1_MIN_REPEAT 3
+#define TYPE_1_MAX_REPEAT 130
+
+static size_t compress_type_1_literals(const unsigned char *literals, size_t count, unsigned char *compressed_data) {
+    size_t compressed_pointer = 0;
+    while (count > 0) {
+        // Write flag byte followed by up to 128 bytes
+        const size_t run_length = count < TYPE_1_MAX_LITERAL ? count : TYPE_1_MAX_LITERAL;
+        compressed_data[compressed_pointer++] = run_length - 1;
+        memcpy(&compressed_data[compressed_pointer], literals, run_length);
+        compressed_pointer += run_length;
+        literals += run_length;
+        count -= run_length;
+    }
+    return compressed_pointer;
+}
+
+static size_t compress_type_1(const unsigned char *uncompressed_data, const size_t uncompressed_size, unsigned char *compressed_data) {
+    size_t compressed_pointer = 0;
+    size_t literal_start = 0;
+    size_t uncompressed_pointer = 0;
+
+    while (uncompressed_pointer < uncompressed_size) {
+        // Measure run of repeated bytes
+        const unsigned char byte = uncompressed_data[uncompressed_pointer];
+        const size_t remaining = uncompressed_size - uncompressed_pointer;
+        const size_t max_run_length = remaining < TYPE_1_MAX_REPEAT ? remaining : TYPE_1_MAX_REPEAT;
+        size_t run_length = 1;
+        while (run_length < max_run_length && uncompressed_data[uncompressed_pointer + run_length] == byte) {
+            run_length++;
+        }
+
+        // Leave short runs in the pending literal bytes
+        if (run_length < TYPE_1_MIN_REPEAT) {
+            uncompressed_pointer += run_length;
+            continue;
+        }
+
+        // Write pending literal bytes followed by the repeated byte
+        compressed_pointer += compress_type_1_literals(&uncompressed_data[literal_start], uncompressed_pointer - literal_start, &compressed_data[compressed_pointer]);
+        compressed_data[compressed_pointer++] = run_length + 125;
+        compressed_data[compressed_pointer++] = byte;
+        uncompressed_pointer += run_length;
+        literal_start = uncompressed_pointer;
+    }
+
+    // Write remaining literal bytes
+    compressed_pointer += compress_type_1_literals(&uncompressed_data[literal_start], uncompressed_size - literal_start, &compressed_data[compressed_pointer]);
+    return compressed_pointer;
+}
+
+// Files larger than this are compressed at the level estimated from a sample of this size
+#define AUTO_SAMPLE_SIZE 49152
+
+// Type 2 to 6 back-references are found by hashing the next three bytes
+#define TYPE_2_MIN_MATCH 3
+#define TYPE_2_MAX_HASH_BITS 15
+
+// Longest hash chain searched for each compression effort
+static const unsigned int max_chain_table[3] = {8, 64, 256};
+
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+    size_t window_size;
+    size_t max_run_length;
+    unsigned int max_chain;
+    unsigned int hash_bits;
+    int32_t *head;
+    int32_t *previous;
+    size_t inserted;
+} match_finder;
+
+typedef struct {
+    unsigned char *data;
+    size_t pointer;
+    size_t flag_pointer;
+    unsigned char flag_bit;
+    unsigned char offset_bits;
+    size_t window_size;
+} type_2_writer;
+
+static inline unsigned int hash_bytes(const unsigned char *bytes, const unsigned int hash_bits) {
+    const uint32_t value = (uint32_t) bytes[0] << 16 | (uint32_t) bytes[1] << 8 | bytes[2];
+    return (value * 2654435761u) >> (32 - hash_bits);
+}
+
+static int match_finder_open(match_finder *finder, const unsigned char *data, const size_t size, const unsigned char offset_bits, const compress_effort effort) {
+    finder->data = data;
+    finder->size = size;
+    finder->window_size = (size_t) 1 << (offset_bits + 8);
+    finder->max_run_length = ((size_t) 1 << (8 - offset_bits)) + 1;
+    finder->max_chain = max_chain_table[effort];
+    finder->inserted = 0;
+
+    // Shrink hash table for small inputs, as it is cleared for every file
+    finder->hash_bits = TYPE_2_MAX_HASH_BITS;
+    while (finder->hash_bits > 8 && ((size_t) 1 << finder->hash_bits) > size * 2) {
+        finder->hash_bits--;
+    }
+
+    finder->head = malloc(sizeof(int32_t) << finder->hash_bits);
+    finder->previous = malloc(sizeof(int32_t) * finder->window_size);
+    if (finder->head == NULL || finder->previous == NULL) {
+        free(finder->head);
+        free(finder->previous);
+        return 0;
+    }
+    memset(finder->head, -1, sizeof(int32_t) << finder->hash_bits);
+    return 1;
+}
+
+static void match_finder_close(match_finder *finder) {
+    free(finder->head);
+    free(finder->previous);
+}
+
+static void match_finder_insert(match_finder *finder, const size_t position) {
+    // Add every position before the given one to its hash chain
+    while (finder->inserted < position) {
+        const size_t inserted = finder->inserted++;
+        if (finder->size - inserted >= TYPE_2_MIN_MATCH) {
+            const unsigned int hash = hash_bytes(&finder->data[inserted], finder->hash_bits);
+            finder->previous[inserted & (finder->window_size - 1)] = finder->head[hash];
+            finder->head[hash] = inserted;
+        }
+    }
+}
+
+static size_t match_finder_find(match_finder *finder, const size_t position, size_t *distance) {
+    match_finder_insert(finder, position);
+
+    const size_t remaining = finder->size - position;
+    if (remaining < TYPE_2_MIN_MATCH) {
+        return 0;
+    }
+    const size_t max_length = remaining < finder->max_run_length ? remaining : finder->max_run_length;
+    const unsigned char *current = &finder->data[position];
+    size_t best_length = 0;
+
+    int32_t candidate = finder->head[hash_bytes(current, finder->hash_bits)];
+    for (unsigned int chain = 0; candidate >= 0 && chain < finder->max_chain; chain++) {
+        // Stop once candidates leave the window
+        const size_t candidate_distance = position - candidate;
+        if (candidate_distance > finder->window_size) {
+            break;
+        }
+
+        // The last position of the circular buffer cannot be encoded as an offset
+        const unsigned char *source = &finder->data[candidate];
+        if (((size_t) candidate & (finder->window_size - 1)) != finder->window_size - 1 && source[best_length] == current[best_length]) {
+            size_t length = 0;
+            while (length < max_length && source[length] == current[length]) {
+                length++;
+            }
+            if (length > best_length) {
+                best_length = length;
+                *distance = candidate_distance;
+                if (length == max_length) {
+                    break;
+                }
+            }
+        }
+        candidate = finder->previous[candidate & (finder->window_size - 1)];
+    }
+
+    return best_length >= TYPE_2_MIN_MATCH ? best_length : 0;
+}
+
+static inline void type_2_next_flag(type_2_writer *writer) {
+    // Start a new flag byte once all eight bits are used
+    if (writer->flag_bit == 8) {
+        writer->flag_pointer = writer->pointer++;
+        writer->data[writer->flag_pointer] = 0;
+        writer->flag_bit = 0;
+    }
+}
+
+static inline void type_2_write_literal(type_2_writer *writer, const unsigned char byte) {
+    type_2_next_flag(writer);
+    writer->data[writer->flag_pointer] |= 1 << writer->flag_bit++;
+    writer->data[writer->pointer++] = byte;
+}
+
+static inline void type_2_write_match(type_2_writer *writer, const size_t position, const size_t distance, const size_t length) {
+    type_2_next_flag(writer);
+    writer->flag_bit++;
+
+    // Encode source as its position in the circular buffer, plus one
+    const size_t offset = ((position - distance) & (writer->window_size - 1)) + 1;
+    writer->data[writer->pointer++] = offset & 0xFF;
+    writer->data[writer->pointer++] = (offset >> 8) | (length - 2) << writer->offset_bits;
+}
+
+static size_t compress_type_2_optimal(match_finder *finder, type_2_writer *writer) {
+    const size_t size = finder->size;
+    uint16_t *lengths = malloc(sizeof(uint16_t) * (size + 1));
+    uint16_t *distances = malloc(sizeof(uint16_t) * (size + 1));
+    uint32_t *costs = malloc(sizeof(uint32_t) * (size + 1));
+    if (lengths == NULL || distances == NULL || costs == NULL) {
+        free(lengths);
+        free(distances);
+        free(costs);
+        return 0;
+    }
+
+    // Find the longest match at every position
+    for (size_t position = 0; position < size; position++) {
+        size_t distance = 0;
+        lengths[position] = match_finder_find(finder, position, &distance);
+        distances[position] = distance;
+    }
+
+    // Find the cheapest encoding of each suffix in bits, where a literal is 9 bits and a match
+    // is 17 bits, trying every length of the longest match as shorter ones share its source
+    costs[size] = 0;
+    for (size_t position = size; position-- > 0;) {
+        uint32_t best_cost = costs[position + 1] + 9;
+        size_t best_length = 1;
+        for (size_t length = 2; length <= lengths[position]; length++) {
+            const uint32_t cost = costs[position + length] + 17;
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_length = length;
+            }
+        }
+        costs[position] = best_cost;
+        lengths[position] = best_length;
+    }
+
+    // Write the cheapest encoding
+    for (size_t position = 0; position < size;) {
+        if (lengths[position] > 1) {
+            type_2_write_match(writer, position, distances[position], lengths[position]);
+            position += lengths[position];
+        } else {
+            type_2_write_literal(writer, finder->data[position]);
+            position++;
+        }
+    }
+
+    free(lengths);
+    free(distances);
+    free(costs);
+    return 1;
+}
+
+static int compress_type_2(const unsigned char *uncompressed_data, const size_t uncompressed_size, unsigned char *compressed_data, size_t *compressed_size, const unsigned char compression_level, const compress_effort effort) {
+    const unsigned char offset_bits = 6 - compression_level;
+    match_finder finder;
+    if (!match_finder_open(&finder, uncompressed_data, uncompressed_size, offset_bits, effort)) {
+        return 0;
+    }
+    type_2_writer writer = {compressed_data, 0, 0, 8, offset_bits, finder.window_size};
+
+    if (effort == COMPRESS_OPTIMAL) {
+        if (!compress_type_2_optimal(&finder, &writer)) {
+            match_finder_close(&finder);
+            return 0;
+        }
+    } else {
+        size_t position = 0;
+        while (position < uncompressed_size) {
+            size_t distance;
+            const size_t length = match_finder_find(&finder, position, &distance);
+
+            // Write a literal instead if a longer match starts at the next byte
+            if (length > 0 && effort == COMPRESS_LAZY && length < finder.max_run_length) {
+                size_t next_distance;
+                if (match_finder_find(&finder, position + 1, &next_distance) > length) {
+                    type_2_write_literal(&writer, uncompressed_data[position++]);
+                    continue;
+                }
+            }
+
+            if (length > 0) {
+                type_2_write_match(&writer, position, distance, length);
+                position += length;
+            } else {
+                type_2_write_literal(&writer, uncompressed_data[position++]);
+            }
+        }
+    }
+
+    match_finder_close(&finder);
+    *compressed_size = writer.pointer;
+    return 1;
+}
+
+static size_t sample_data(const unsigned char *uncompressed_data, const size_t uncompressed_size, unsigned char *sample) {
+    // Take slices from the start, middle and end of the data
+    const size_t slice_size = AUTO_SAMPLE_SIZE / 3;
+    const size_t slice_starts[3] = {0, (uncompressed_size - slice_size) / 2, uncompressed_size - slice_size};
+    for (int i = 0; i < 3; i++) {
+        memcpy(&sample[i * slice_size], &uncompressed_data[slice_starts[i]], slice_size);
+    }
+    return slice_size * 3;
+}
+
+static unsigned char estimate_level(const unsigned char *sample, const size_t sample_size, unsigned char *compressed_data) {
+    // Compress sample at every level with fast effort and pick the smallest, preferring lower levels
+    unsigned char best_level = 0;
+    size_t best_size = sample_size;
+    for (unsigned char level = 1; level <= 6; level++) {
+        size_t compressed_size;
+        if (compress(sample, sample_size, compressed_data, &compressed_size, level, COMPRESS_FAST) && compressed_size < best_size) {
+            best_level = level;
+            best_size = compressed_size;
+        }
+    }
+    return best_level;
+}
+
+bool compress_supported(const unsigned char compression_level) {
+    return compression_level <= 6 || compression_level == COMPRESSION_AUTO;
+}
+
+size_t compress_bound(const size_t uncompressed_size, const unsigned char compression_level) {
+    if (compression_level == 1) {
+        // Every 128 literal bytes need a flag byte
+        return uncompressed_size + (uncompressed_size + TYPE_1_MAX_LITERAL - 1) / TYPE_1_MAX_LITERAL;
+    } else if (compression_level > 1) {
+        // Every 8 literal bytes need a flag byte, which is also the largest of any level
+        return uncompressed_size + (uncompressed_size + 7) / 8;
+    }
+    return uncompressed_size;
+}
+
+int compress(const unsigned char *uncompressed_data, const size_t uncompressed_size, unsigned char *compressed_data, size_t *compressed_size, const unsigned char compression_level, const compress_effort effort) {
+    if (compression_level == 0) {
+        memcpy(compressed_data, uncompressed_data, uncompressed_size);
+        *compressed_size = uncompressed_size;
+        return 1;
+    } else if (compression_level == 1) {
+        *compressed_size = compress_type_1(uncompressed_data, uncompressed_size, compressed_data);
+        return 1;
+    } else if (compression_level <= 6) {
+        return compress_type_2(uncompressed_data, uncompressed_size, compressed_data, compressed_size, compression_level, effort);
+    }
+    return 0;
+}
+
+int compress_auto(const unsigned char *uncompressed_data, const size_t uncompressed_size, unsigned char *compressed_data, size_t *compressed_size, unsigned char *compression_level, const compress_effort effort) {
+    // Store data by default
+    unsigned char best_level = 0;
+    size_t best_size = uncompressed_size;
+
+    // Create scratch buffer for trial compression
+    const size_t trial_size = uncompressed_size > AUTO_SAMPLE_SIZE ? AUTO_SAMPLE_SIZE : uncompressed_size;
+    unsigned char *trial_data = malloc(compress_bound(trial_size, COMPRESSION_AUTO) + trial_size);
+    if (trial_data == NULL) {
+        return 0;
+    }
+
+    if (uncompressed_size <= AUTO_SAMPLE_SIZE) {
+        // Small files are compressed at every level, keeping the smallest
+        for (unsigned char level = 1; level <= 6; level++) {
+            size_t trial_compressed_size;
+            if (!compress(uncompressed_data, uncompressed_size, trial_data, &trial_compressed_size, level, effort)) {
+                free(trial_data);
+                return 0;
+            }
+            if (trial_compressed_size < best_size) {
+                memcpy(compressed_data, trial_data, trial_compressed_size);
+                best_level = level;
+                best_size = trial_compressed_size;
+            }
+        }
+    } else {
+        // Large files are compressed once at the level which compresses a sample best
+        unsigned char *sample = &trial_data[compress_bound(trial_size, COMPRESSION_AUTO)];
+        const size_t sample_size = sample_data(uncompressed_data, uncompressed_size, sample);
+        const unsigned char level = estimate_level(sample, sample_size, trial_data);
+        size_t level_size;
+        if (level > 0) {
+            if (!compress(uncompressed_data, uncompressed_size, compressed_data, &level_size, level, effort)) {
+                free(trial_data);
+                return 0;
+            }
+            if (level_size < best_size) {
+                best_level = level;
+                best_size = level_size;
+            }
+        }
+    }
+    free(trial_data);
+
+    // Fall back to storing data when compression does not help
+    if (best_level == 0) {
+        memcpy(compressed_data, uncompressed_data, uncompressed_size);
+    }
+    *compressed_size = best_size;
+    *compression_level = best_level;
+    return 1;
+}
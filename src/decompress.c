@@ -0,0 +1,530 @@
+/*
+ * Red Archive
+ * MIT License
+ * Copyright (c) 2020 Jacob Gelling
+ */
+
+#include "decompress.h"
+
+// Use SSE2 where it is part of the target, and AVX2 where the compiler can detect it at runtime
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define REDARCHIVE_SSE2
+#endif
+#if defined(REDARCHIVE_SSE2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #include <immintrin.h>
+    #define REDARCHIVE_AVX2
+#endif
+
+static decompress_result decompress_type_0(const unsigned char *compressed_data, const size_t compressed_size, unsigned char *uncompressed_data, const size_t uncompressed_size) {
+    // Copy as much data as fits
+    const size_t copy_size = compressed_size < uncompressed_size ? compressed_size : uncompressed_size;
+    memcpy(uncompressed_data, compressed_data, copy_size);
+    memset(&uncompressed_data[copy_size], 0, uncompressed_size - copy_size);
+
+    if (compressed_size != uncompressed_size) {
+        return DECOMPRESS_SIZE_MISMATCH;
+    }
+    return DECOMPRESS_SUCCESS;
+}
+
+// Type 1 runs are at most 128 literal bytes or 130 repeated bytes
+#define TYPE_1_MAX_LITERAL 128
+#define TYPE_1_MAX_REPEAT 130
+
+// Decode type 1 runs while the input and output have room for whole vector stores,
+// leaving the pointers at the first run which must be decoded with bounds checks
+typedef void (*type_1_decoder)(const unsigned char *compressed_data, size_t compressed_size, size_t *compressed_pointer, unsigned char *uncompressed_data, size_t uncompressed_size, size_t *uncompressed_pointer);
+
+#ifdef REDARCHIVE_SSE2
+static void decompress_type_1_sse2(const unsigned char *compressed_data, const size_t compressed_size, size_t *compressed_pointer, unsigned char *uncompressed_data, const size_t uncompressed_size, size_t *uncompressed_pointer) {
+    size_t input = *compressed_pointer;
+    size_t output = *uncompressed_pointer;
+
+    // Runs are rounded up to 16 bytes, so require a flag byte and the longest literal run of input, and the longest repeat run of output
+    while (compressed_size - input > TYPE_1_MAX_LITERAL && uncompressed_size - output >= ((TYPE_1_MAX_REPEAT + 15) & ~15)) {
+        const unsigned char flag = compressed_data[input++];
+        unsigned char *destination = &uncompressed_data[output];
+
+        // Broadcast repeated byte
+        if (flag > 127) {
+            const size_t count = flag - 125;
+            const __m128i bytes = _mm_set1_epi8(compressed_data[input++]);
+            for (size_t i = 0; i < count; i += 16) {
+                _mm_storeu_si128((__m128i *) &destination[i], bytes);
+            }
+            output += count;
+
+        // Copy literal bytes
+        } else {
+            const size_t count = (size_t) flag + 1;
+            const unsigned char *source = &compressed_data[input];
+            for (size_t i = 0; i < count; i += 16) {
+                _mm_storeu_si128((__m128i *) &destination[i], _mm_loadu_si128((const __m128i *) &source[i]));
+            }
+            input += count;
+            output += count;
+        }
+    }
+
+    *compressed_pointer = input;
+    *uncompressed_pointer = output;
+}
+#endif
+
+#ifdef REDARCHIVE_AVX2
+__attribute__((target("avx2")))
+static void decompress_type_1_avx2(const unsigned char *compressed_data, const size_t compressed_size, size_t *compressed_pointer, unsigned char *uncompressed_data, const size_t uncompressed_size, size_t *uncompressed_pointer) {
+    size_t input = *compressed_pointer;
+    size_t output = *uncompressed_pointer;
+
+    // Runs are rounded up to 32 bytes, so require a flag byte and the longest literal run of input, and the longest repeat run of output
+    while (compressed_size - input > TYPE_1_MAX_LITERAL && uncompressed_size - output >= ((TYPE_1_MAX_REPEAT + 31) & ~31)) {
+        const unsigned char flag = compressed_data[input++];
+        unsigned char *destination = &uncompressed_data[output];
+
+        // Broadcast repeated byte
+        if (flag > 127) {
+            const size_t count = flag - 125;
+            const __m256i bytes = _mm256_set1_epi8(compressed_data[input++]);
+            for (size_t i = 0; i < count; i += 32) {
+                _mm256_storeu_si256((__m256i *) &destination[i], bytes);
+            }
+            output += count;
+
+        // Copy literal bytes
+        } else {
+            const size_t count = (size_t) flag + 1;
+            const unsigned char *source = &compressed_data[input];
+            for (size_t i = 0; i < count; i += 32) {
+                _mm256_storeu_si256((__m256i *) &destination[i], _mm256_loadu_si256((const __m256i *) &source[i]));
+            }
+            input += count;
+            output += count;
+        }
+    }
+
+    *compressed_pointer = input;
+    *uncompressed_pointer = output;
+}
+#endif
+
+static type_1_decoder select_type_1_decoder(void) {
+    #ifdef REDARCHIVE_AVX2
+        if (__builtin_cpu_supports("avx2")) {
+            return decompress_type_1_avx2;
+        }
+    #endif
+    #ifdef REDARCHIVE_SSE2
+        return decompress_type_1_sse2;
+    #else
+        return NULL;
+    #endif
+}
+
+static decompress_result decompress_type_1(const unsigned char *compressed_data, const size_t compressed_size, unsigned char *uncompressed_data, const size_t uncompressed_size) {
+    size_t compressed_pointer = 0;
+    size_t uncompressed_pointer = 0;
+    decompress_result result = DECOMPRESS_SUCCESS;
+
+    // Decode the bulk of the data with the fastest available vector decoder
+    const type_1_decoder vector_decoder = select_type_1_decoder();
+    if (vector_decoder != NULL) {
+        vector_decoder(compressed_data, compressed_size, &compressed_pointer, uncompressed_data, uncompressed_size, &uncompressed_pointer);
+    }
+
+    // While there is still compressed data to read
+    while (compressed_pointer < compressed_size) {
+        // Read flag byte
+        const unsigned char flag = compressed_data[compressed_pointer++];
+
+        // Next byte is duplicated x times
+        if (flag > 127) {
+            // Calculate times to duplicate
+            const unsigned char count = flag - 125;
+
+            // Stop if byte is missing or output would overflow
+            if (compressed_pointer >= compressed_size || uncompressed_size - uncompressed_pointer < count) {
+                result = DECOMPRESS_SIZE_MISMATCH;
+                break;
+            }
+
+            // Duplicate byte and write to uncompressed data buffer
+            memset(&uncompressed_data[uncompressed_pointer], compressed_data[compressed_pointer++], count);
+            uncompressed_pointer += count;
+        // Next x bytes are copied without duplication
+        } else {
+            // Stop if bytes are missing or output would overflow
+            const size_t count = (size_t) flag + 1;
+            if (compressed_size - compressed_pointer < count || uncompressed_size - uncompressed_pointer < count) {
+                result = DECOMPRESS_SIZE_MISMATCH;
+                break;
+            }
+
+            memcpy(&uncompressed_data[uncompressed_pointer], &compressed_data[compressed_pointer], count);
+            compressed_pointer += count;
+            uncompressed_pointer += count;
+        }
+    }
+
+    // Check output matches expected size
+    if (uncompressed_pointer != uncompressed_size) {
+        memset(&uncompressed_data[uncompressed_pointer], 0, uncompressed_size - uncompressed_pointer);
+        result = DECOMPRESS_SIZE_MISMATCH;
+    }
+    return result;
+}
+
+// Bits of the second back-reference byte holding the high offset bits, indexed by compression level
+static const unsigned char offset_bits_table[7] = {0, 0, 4, 3, 2, 1, 0};
+
+static inline decompress_result copy_back_reference(const unsigned char *back_reference, const unsigned char offset_bits, unsigned char *uncompressed_data, size_t *uncompressed_pointer, const size_t uncompressed_size) {
+    // Split back-reference into offset and run length
+    const unsigned int offset_mask = (1 << offset_bits) - 1;
+    const int offset = (back_reference[0] | (back_reference[1] & offset_mask) << 8) - 1;
+    const size_t run_length = (back_reference[1] >> offset_bits) + 2;
+    if (offset < 0) {
+        return DECOMPRESS_INVALID_OFFSET;
+    }
+
+    // The offset is a position in a circular buffer the size of the window which the
+    // output is written through, so translate it into a distance back from the output
+    const size_t window_mask = ((size_t) 1 << (offset_bits + 8)) - 1;
+    size_t distance = (*uncompressed_pointer - offset) & window_mask;
+    if (distance == 0) {
+        distance = window_mask + 1;
+    }
+
+    // Check offset has been written to
+    if (distance > *uncompressed_pointer) {
+        return DECOMPRESS_INVALID_OFFSET;
+    }
+
+    // Stop if output would overflow
+    const size_t space = uncompressed_size - *uncompressed_pointer;
+    if (space < run_length) {
+        return DECOMPRESS_SIZE_MISMATCH;
+    }
+
+    // Copy run from earlier in the output, where bytes past the run are overwritten later
+    unsigned char *output = &uncompressed_data[*uncompressed_pointer];
+    const unsigned char *source = output - distance;
+    if (distance == 1) {
+        memset(output, *source, run_length);
+    } else if (distance >= 16 && space >= ((run_length + 15) & ~(size_t) 15)) {
+        for (size_t i = 0; i < run_length; i += 16) {
+            memcpy(&output[i], &source[i], 16);
+        }
+    } else if (distance >= 8 && space >= ((run_length + 7) & ~(size_t) 7)) {
+        for (size_t i = 0; i < run_length; i += 8) {
+            memcpy(&output[i], &source[i], 8);
+        }
+    } else {
+        for (size_t i = 0; i < run_length; i++) {
+            output[i] = source[i];
+        }
+    }
+    *uncompressed_pointer += run_length;
+    return DECOMPRESS_SUCCESS;
+}
+
+static decompress_result decompress_type_2(const unsigned char *compressed_data, const size_t compressed_size, unsigned char *uncompressed_data, const size_t uncompressed_size, const unsigned char compression_level) {
+    // Look up bits used for offset
+    const unsigned char offset_bits = offset_bits_table[compression_level];
+
+    // Create compressed and uncompressed pointers
+    size_t compressed_pointer = 0;
+    size_t uncompressed_pointer = 0;
+    decompress_result result = DECOMPRESS_SUCCESS;
+
+    // While there is still compressed data to read
+    while (compressed_pointer < compressed_size && result == DECOMPRESS_SUCCESS) {
+        // Read flag byte
+        const unsigned char flag = compressed_data[compressed_pointer++];
+
+        // Copy eight uncompressed bytes at once
+        if (flag == 0xFF && compressed_size - compressed_pointer >= 8 && uncompressed_size - uncompressed_pointer >= 8) {
+            memcpy(&uncompressed_data[uncompressed_pointer], &compressed_data[compressed_pointer], 8);
+            compressed_pointer += 8;
+            uncompressed_pointer += 8;
+            continue;
+        }
+
+        // Copy eight back-references without testing flag bits
+        if (flag == 0x00 && compressed_size - compressed_pointer >= 16) {
+            for (unsigned char i = 0; i < 8 && result == DECOMPRESS_SUCCESS; i++) {
+                result = copy_back_reference(&compressed_data[compressed_pointer], offset_bits, uncompressed_data, &uncompressed_pointer, uncompressed_size);
+                compressed_pointer += 2;
+            }
+            continue;
+        }
+
+        for (unsigned char bit = 0; bit < 8; bit++) {
+            // If data is uncompressed
+            if (flag & (1 << bit)) {
+                // Stop if byte is missing or output would overflow
+                if (compressed_pointer >= compressed_size || uncompressed_pointer >= uncompressed_size) {
+                    result = DECOMPRESS_SIZE_MISMATCH;
+                    break;
+                }
+
+                // Write byte to uncompressed buffer
+                uncompressed_data[uncompressed_pointer++] = compressed_data[compressed_pointer++];
+
+            // If data is compressed
+            } else {
+                // Stop if back-reference is incomplete
+                if (compressed_size - compressed_pointer < 2) {
+                    compressed_pointer = compressed_size;
+                    result = DECOMPRESS_SIZE_MISMATCH;
+                    break;
+                }
+
+                result = copy_back_reference(&compressed_data[compressed_pointer], offset_bits, uncompressed_data, &uncompressed_pointer, uncompressed_size);
+                compressed_pointer += 2;
+                if (result != DECOMPRESS_SUCCESS) {
+                    break;
+                }
+            }
+            if (compressed_pointer >= compressed_size) {
+                break;
+            }
+        }
+    }
+
+    // Check output matches expected size
+    if (uncompressed_pointer != uncompressed_size) {
+        memset(&uncompressed_data[uncompressed_pointer], 0, uncompressed_size - uncompressed_pointer);
+        if (result == DECOMPRESS_SUCCESS) {
+            result = DECOMPRESS_SIZE_MISMATCH;
+        }
+    }
+    return result;
+}
+
+// Longest output of one token, which is a type 2 back-reference at level 6
+#define STREAM_MAX_RUN 257
+#define STREAM_WINDOW_MASK (DECOMPRESS_STREAM_WINDOW_SIZE - 1)
+
+void decompress_stream_open(decompress_stream *stream, const size_t uncompressed_size, const unsigned char compression_level) {
+    stream->compression_level = compression_level;
+    stream->uncompressed_size = uncompressed_size;
+    stream->decoded_size = 0;
+    stream->written_size = 0;
+    stream->result = compression_level <= 6 ? DECOMPRESS_SUCCESS : DECOMPRESS_UNSUPPORTED;
+    stream->finished = false;
+    stream->flag = 0;
+    stream->flag_bit = 8;
+    stream->flag_fresh = false;
+    stream->token_size = 0;
+}
+
+static size_t stream_token_size(const decompress_stream *stream, const unsigned char first_byte) {
+    // Type 1 tokens are a flag followed by a repeated byte or literal bytes
+    if (stream->compression_level == 1) {
+        return first_byte > 127 ? 2 : (size_t) first_byte + 2;
+    }
+
+    // Type 2 tokens are a flag, a literal byte or a back-reference
+    if (stream->flag_bit == 8 || stream->flag & (1 << stream->flag_bit)) {
+        return 1;
+    }
+    return 2;
+}
+
+static void stream_decode_token(decompress_stream *stream, const unsigned char *token) {
+    unsigned char *window = stream->window;
+    const size_t space = stream->uncompressed_size - stream->decoded_size;
+
+    // Decode type 1 runs
+    if (stream->compression_level == 1) {
+        if (token[0] > 127) {
+            const size_t count = token[0] - 125;
+            if (space < count) {
+                stream->result = DECOMPRESS_SIZE_MISMATCH;
+                return;
+            }
+            for (size_t i = 0; i < count; i++) {
+                window[(stream->decoded_size + i) & STREAM_WINDOW_MASK] = token[1];
+            }
+            stream->decoded_size += count;
+        } else {
+            const size_t count = (size_t) token[0] + 1;
+            if (space < count) {
+                stream->result = DECOMPRESS_SIZE_MISMATCH;
+                return;
+            }
+            for (size_t i = 0; i < count; i++) {
+                window[(stream->decoded_size + i) & STREAM_WINDOW_MASK] = token[1 + i];
+            }
+            stream->decoded_size += count;
+        }
+        return;
+    }
+
+    // Read type 2 flag byte
+    if (stream->flag_bit == 8) {
+        stream->flag = token[0];
+        stream->flag_bit = 0;
+        stream->flag_fresh = true;
+        return;
+    }
+    stream->flag_fresh = false;
+
+    // Write literal byte
+    if (stream->flag & (1 << stream->flag_bit++)) {
+        if (space == 0) {
+            stream->result = DECOMPRESS_SIZE_MISMATCH;
+            return;
+        }
+        window[stream->decoded_size++ & STREAM_WINDOW_MASK] = token[0];
+        return;
+    }
+
+    // Copy back-reference from the window, translating its offset as copy_back_reference does
+    const unsigned char offset_bits = offset_bits_table[stream->compression_level];
+    const unsigned int offset_mask = (1 << offset_bits) - 1;
+    const int offset = (token[0] | (token[1] & offset_mask) << 8) - 1;
+    const size_t run_length = (token[1] >> offset_bits) + 2;
+    const size_t window_mask = ((size_t) 1 << (offset_bits + 8)) - 1;
+    size_t distance = (stream->decoded_size - offset) & window_mask;
+    if (distance == 0) {
+        distance = window_mask + 1;
+    }
+    if (offset < 0 || distance > stream->decoded_size) {
+        stream->result = DECOMPRESS_INVALID_OFFSET;
+        return;
+    }
+    if (space < run_length) {
+        stream->result = DECOMPRESS_SIZE_MISMATCH;
+        return;
+    }
+    const size_t start = stream->decoded_size & STREAM_WINDOW_MASK;
+    const size_t source = (stream->decoded_size - distance) & STREAM_WINDOW_MASK;
+    if (distance >= run_length && start + run_length <= DECOMPRESS_STREAM_WINDOW_SIZE && source + run_length <= DECOMPRESS_STREAM_WINDOW_SIZE) {
+        memcpy(&window[start], &window[source], run_length);
+    } else {
+        for (size_t i = 0; i < run_length; i++) {
+            window[(start + i) & STREAM_WINDOW_MASK] = window[(source + i) & STREAM_WINDOW_MASK];
+        }
+    }
+    stream->decoded_size += run_length;
+}
+
+static size_t stream_drain(decompress_stream *stream, unsigned char *output, const size_t output_size) {
+    // Copy decoded bytes out of the window, which wraps at most once
+    size_t written = 0;
+    while (written < output_size && stream->written_size < stream->decoded_size) {
+        const size_t start = stream->written_size & STREAM_WINDOW_MASK;
+        size_t count = stream->decoded_size - stream->written_size;
+        if (count > DECOMPRESS_STREAM_WINDOW_SIZE - start) {
+            count = DECOMPRESS_STREAM_WINDOW_SIZE - start;
+        }
+        if (count > output_size - written) {
+            count = output_size - written;
+        }
+        memcpy(&output[written], &stream->window[start], count);
+        stream->written_size += count;
+        written += count;
+    }
+    return written;
+}
+
+size_t decompress_stream_update(decompress_stream *stream, const unsigned char *input, const size_t input_size, size_t *input_used, unsigned char *output, const size_t output_size) {
+    size_t input_pointer = 0;
+    size_t output_pointer = 0;
+
+    // Consume everything when the compression level is unsupported
+    if (stream->result == DECOMPRESS_UNSUPPORTED) {
+        *input_used = input_size;
+        return 0;
+    }
+
+    // Copy uncompressed data straight to the output, discarding any past the expected size
+    if (stream->compression_level == 0) {
+        size_t count = stream->uncompressed_size - stream->decoded_size;
+        count = count < input_size ? count : input_size;
+        count = count < output_size ? count : output_size;
+        memcpy(output, input, count);
+        stream->decoded_size += count;
+        stream->written_size += count;
+        input_pointer = count;
+        if (input_pointer < input_size && stream->decoded_size == stream->uncompressed_size) {
+            stream->result = DECOMPRESS_SIZE_MISMATCH;
+            input_pointer = input_size;
+        }
+        *input_used = input_pointer;
+        return count;
+    }
+
+    // Keep the history back-references can reach, plus the longest run, within the window
+    const size_t history_size = stream->compression_level == 1 ? 0 : (size_t) 1 << (offset_bits_table[stream->compression_level] + 8);
+    while (1) {
+        output_pointer += stream_drain(stream, &output[output_pointer], output_size - output_pointer);
+
+        // Consume everything once decoding has stopped
+        if (stream->result != DECOMPRESS_SUCCESS) {
+            input_pointer = input_size;
+            break;
+        }
+        if (input_pointer == input_size || stream->decoded_size - stream->written_size + STREAM_MAX_RUN > DECOMPRESS_STREAM_WINDOW_SIZE - history_size) {
+            break;
+        }
+
+        // Decode whole tokens straight from the input, and collect split tokens first
+        const size_t token_size = stream_token_size(stream, stream->token_size > 0 ? stream->token[0] : input[input_pointer]);
+        if (stream->token_size == 0 && input_size - input_pointer >= token_size) {
+            stream_decode_token(stream, &input[input_pointer]);
+            input_pointer += token_size;
+        } else {
+            size_t count = token_size - stream->token_size;
+            count = count < input_size - input_pointer ? count : input_size - input_pointer;
+            memcpy(&stream->token[stream->token_size], &input[input_pointer], count);
+            stream->token_size += count;
+            input_pointer += count;
+            if (stream->token_size == token_size) {
+                stream->token_size = 0;
+                stream_decode_token(stream, stream->token);
+            }
+        }
+    }
+
+    *input_used = input_pointer;
+    return output_pointer;
+}
+
+size_t decompress_stream_finish(decompress_stream *stream, unsigned char *output, const size_t output_size) {
+    // Fail on a token cut short by the end of the input, or a flag byte with nothing after it
+    if (!stream->finished) {
+        stream->finished = true;
+        if (stream->result == DECOMPRESS_SUCCESS && (stream->token_size > 0 || stream->flag_fresh)) {
+            stream->result = DECOMPRESS_SIZE_MISMATCH;
+        }
+    }
+
+    // Write remaining decoded bytes, then zero-fill the rest of the output
+    size_t written = stream_drain(stream, output, output_size);
+    if (stream->written_size == stream->decoded_size) {
+        size_t count = stream->uncompressed_size - stream->written_size;
+        count = count < output_size - written ? count : output_size - written;
+        memset(&output[written], 0, count);
+        stream->written_size += count;
+        stream->decoded_size += count;
+        written += count;
+        if (count > 0 && stream->result == DECOMPRESS_SUCCESS) {
+            stream->result = DECOMPRESS_SIZE_MISMATCH;
+        }
+    }
+    return written;
+}
+
+decompress_result decompress(const unsigned char *compressed_data, const size_t compressed_size, unsigned char *uncompressed_data, const size_t uncompressed_size, const unsigned char compression_level) {
+    if (compression_level == 0) {
+        return decompress_type_0(compressed_data, compressed_size, uncompressed_data, uncompressed_size);
+    } else if (compression_level == 1) {
+        return decompress_type_1(compressed_data, compressed_size, uncompressed_data, uncompressed_size);
+    } else if (compression_level <= 6) {
+        return decompress_type_2(compressed_data, compressed_size, uncompressed_data, uncompressed_size, compression_level);
+    }
+    return DECOMPRESS_UNSUPPORTED;
+}
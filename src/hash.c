@@ -0,0 +1,130 @@
+/*
+ * Red Archive
+ * MIT License
+ * Copyright (c) 2020 Jacob Gelling
+ */
+
+#include "hash.h"
+
+// XXH64 primes
+#define PRIME_1 0x9E3779B185EBCA87ULL
+#define PRIME_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME_3 0x165667B19E3779F9ULL
+#define PRIME_4 0x85EBCA77C2B2AE63ULL
+#define PRIME_5 0x27D4EB2F165667C5ULL
+
+static inline uint64_t rotate_left(const uint64_t value, const int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static inline uint64_t read_uint64(const unsigned char *bytes) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) {
+        value = value << 8 | bytes[i];
+    }
+    return value;
+}
+
+static inline uint32_t read_uint32(const unsigned char *bytes) {
+    return (uint32_t) bytes[0] | (uint32_t) bytes[1] << 8 | (uint32_t) bytes[2] << 16 | (uint32_t) bytes[3] << 24;
+}
+
+static inline uint64_t round_accumulator(uint64_t accumulator, const uint64_t input) {
+    accumulator += input * PRIME_2;
+    accumulator = rotate_left(accumulator, 31);
+    return accumulator * PRIME_1;
+}
+
+static inline uint64_t merge_accumulator(uint64_t hash, const uint64_t accumulator) {
+    hash ^= round_accumulator(0, accumulator);
+    return hash * PRIME_1 + PRIME_4;
+}
+
+static void hash_stripe(hash_state *state, const unsigned char *stripe) {
+    for (int i = 0; i < 4; i++) {
+        state->accumulators[i] = round_accumulator(state->accumulators[i], read_uint64(&stripe[i * 8]));
+    }
+}
+
+void hash_reset(hash_state *state) {
+    state->accumulators[0] = PRIME_1 + PRIME_2;
+    state->accumulators[1] = PRIME_2;
+    state->accumulators[2] = 0;
+    state->accumulators[3] = -PRIME_1;
+    state->buffer_size = 0;
+    state->total_size = 0;
+}
+
+void hash_update(hash_state *state, const void *data, size_t size) {
+    const unsigned char *bytes = data;
+    state->total_size += size;
+
+    // Complete a buffered stripe
+    if (state->buffer_size > 0) {
+        const size_t fill_size = size < 32 - state->buffer_size ? size : 32 - state->buffer_size;
+        memcpy(&state->buffer[state->buffer_size], bytes, fill_size);
+        state->buffer_size += fill_size;
+        bytes += fill_size;
+        size -= fill_size;
+        if (state->buffer_size < 32) {
+            return;
+        }
+        hash_stripe(state, state->buffer);
+        state->buffer_size = 0;
+    }
+
+    // Hash whole stripes in place, then buffer the remainder
+    while (size >= 32) {
+        hash_stripe(state, bytes);
+        bytes += 32;
+        size -= 32;
+    }
+    memcpy(state->buffer, bytes, size);
+    state->buffer_size = size;
+}
+
+uint64_t hash_digest(const hash_state *state) {
+    uint64_t hash;
+    if (state->total_size >= 32) {
+        hash = rotate_left(state->accumulators[0], 1) + rotate_left(state->accumulators[1], 7) + rotate_left(state->accumulators[2], 12) + rotate_left(state->accumulators[3], 18);
+        for (int i = 0; i < 4; i++) {
+            hash = merge_accumulator(hash, state->accumulators[i]);
+        }
+    } else {
+        hash = PRIME_5;
+    }
+    hash += state->total_size;
+
+    // Mix in remaining bytes
+    const unsigned char *bytes = state->buffer;
+    size_t size = state->buffer_size;
+    for (; size >= 8; bytes += 8, size -= 8) {
+        hash ^= round_accumulator(0, read_uint64(bytes));
+        hash = rotate_left(hash, 27) * PRIME_1 + PRIME_4;
+    }
+    if (size >= 4) {
+        hash ^= read_uint32(bytes) * PRIME_1;
+        hash = rotate_left(hash, 23) * PRIME_2 + PRIME_3;
+        bytes += 4;
+        size -= 4;
+    }
+    for (; size > 0; bytes++, size--) {
+        hash ^= *bytes * PRIME_5;
+        hash = rotate_left(hash, 11) * PRIME_1;
+    }
+
+    // Avalanche
+    hash ^= hash >> 33;
+    hash *= PRIME_2;
+    hash ^= hash >> 29;
+    hash *= PRIME_3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+uint64_t hash_data(const void *data, const size_t size) {
+    hash_state state;
+    hash_reset(&state);
+    hash_update(&state, data, size);
+    return hash_digest(&state);
+}
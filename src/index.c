@@ -0,0 +1,252 @@
+/*
+ * Red Archive
+ * MIT License
+ * Copyright (c) 2020 Jacob Gelling
+ */
+
+#include "index.h"
+
+// Sidecar header: magic, version, archive size, archive modification time and entry count
+#define INDEX_MAGIC "RAIX"
+#define INDEX_VERSION 1
+#define INDEX_HEADER_SIZE 32
+
+// Sidecar record: filename, compression level, compressed size, uncompressed size, data offset and hash
+#define INDEX_RECORD_SIZE 40
+
+static inline void write_uint32(unsigned char *bytes, const uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        bytes[i] = (value >> 8 * i) & 0xFF;
+    }
+}
+
+static inline void write_uint64(unsigned char *bytes, const uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        bytes[i] = (value >> 8 * i) & 0xFF;
+    }
+}
+
+static inline uint32_t read_uint32(const unsigned char *bytes) {
+    return (uint32_t) bytes[0] | (uint32_t) bytes[1] << 8 | (uint32_t) bytes[2] << 16 | (uint32_t) bytes[3] << 24;
+}
+
+static inline uint64_t read_uint64(const unsigned char *bytes) {
+    return (uint64_t) read_uint32(bytes) | (uint64_t) read_uint32(&bytes[4]) << 32;
+}
+
+static char *make_index_path(const char *archive_path) {
+    char *index_path = malloc(strlen(archive_path) + strlen(INDEX_SUFFIX) + 1);
+    if (index_path != NULL) {
+        strcpy(index_path, archive_path);
+        strcat(index_path, INDEX_SUFFIX);
+    }
+    return index_path;
+}
+
+int compare_filenames(const char *first, const char *second) {
+    for (size_t i = 0; first[i] != '\0' || second[i] != '\0'; i++) {
+        const int difference = toupper((unsigned char) first[i]) - toupper((unsigned char) second[i]);
+        if (difference != 0) {
+            return difference;
+        }
+    }
+    return 0;
+}
+
+int archive_index_build(archive_index *index, const void *data, const size_t size) {
+    index->entries = NULL;
+    index->entry_count = 0;
+    index->hashes = NULL;
+    index->error = NULL;
+
+    // Read each header, which skips straight over the compressed data
+    archive_reader reader;
+    archive_reader_open(&reader, data, size);
+    archive_entry entry;
+    size_t entry_capacity = 0;
+    int status;
+    while ((status = archive_reader_next(&reader, &entry)) == 1) {
+        if (index->entry_count == entry_capacity) {
+            entry_capacity = entry_capacity ? entry_capacity * 2 : 64;
+            archive_entry *grown_entries = realloc(index->entries, entry_capacity * sizeof(archive_entry));
+            if (grown_entries == NULL) {
+                index->error = "Could not allocate memory for index";
+                return 0;
+            }
+            index->entries = grown_entries;
+        }
+        index->entries[index->entry_count++] = entry;
+    }
+
+    if (status == -1) {
+        index->error = reader.error;
+        return 0;
+    }
+    return 1;
+}
+
+int archive_index_hash(archive_index *index) {
+    free(index->hashes);
+    index->hashes = malloc(index->entry_count * sizeof(uint64_t));
+    if (index->hashes == NULL && index->entry_count > 0) {
+        return 0;
+    }
+
+    // Decompress each entry into a buffer reused between entries
+    unsigned char *buffer = NULL;
+    size_t buffer_size = 0;
+    for (size_t i = 0; i < index->entry_count; i++) {
+        const archive_entry *entry = &index->entries[i];
+        if (entry->compression_level == 0) {
+            index->hashes[i] = hash_data(entry->data, entry->compressed_size);
+            continue;
+        }
+        if (entry->compression_level > 6) {
+            index->hashes[i] = 0;
+            continue;
+        }
+        if (buffer_size < entry->uncompressed_size) {
+            unsigned char *grown_buffer = realloc(buffer, entry->uncompressed_size);
+            if (grown_buffer == NULL) {
+                free(buffer);
+                return 0;
+            }
+            buffer = grown_buffer;
+            buffer_size = entry->uncompressed_size;
+        }
+
+        // Hash what unpacking would write, even if the entry does not decompress cleanly
+        archive_extract(entry, buffer, buffer_size);
+        index->hashes[i] = hash_data(buffer, entry->uncompressed_size);
+    }
+    free(buffer);
+    return 1;
+}
+
+int archive_index_save(const archive_index *index, const char *archive_path, const void *data) {
+    // Record the archive's size and modification time
+    struct stat archive_stat;
+    if ((index->hashes == NULL && index->entry_count > 0) || index->entry_count > UINT32_MAX || stat(archive_path, &archive_stat) != 0) {
+        return 0;
+    }
+
+    // Encode the index
+    const size_t index_size = INDEX_HEADER_SIZE + index->entry_count * INDEX_RECORD_SIZE;
+    unsigned char *bytes = calloc(index_size, 1);
+    if (bytes == NULL) {
+        return 0;
+    }
+    memcpy(bytes, INDEX_MAGIC, 4);
+    write_uint32(&bytes[4], INDEX_VERSION);
+    write_uint64(&bytes[8], archive_stat.st_size);
+    write_uint64(&bytes[16], archive_stat.st_mtime);
+    write_uint32(&bytes[24], index->entry_count);
+    for (size_t i = 0; i < index->entry_count; i++) {
+        const archive_entry *entry = &index->entries[i];
+        unsigned char *record = &bytes[INDEX_HEADER_SIZE + i * INDEX_RECORD_SIZE];
+        memcpy(record, entry->filename, strlen(entry->filename));
+        record[13] = entry->compression_level;
+        write_uint32(&record[16], entry->compressed_size);
+        write_uint32(&record[20], entry->uncompressed_size);
+        write_uint64(&record[24], entry->data - (const unsigned char *) data);
+        write_uint64(&record[32], index->hashes[i]);
+    }
+
+    // Write the index to its sidecar file
+    char *index_path = make_index_path(archive_path);
+    FILE *index_pointer = index_path != NULL ? fopen(index_path, "wb") : NULL;
+    free(index_path);
+    int write_status = index_pointer != NULL && fwrite(bytes, index_size, 1, index_pointer) == 1;
+    if (index_pointer != NULL) {
+        write_status = fclose(index_pointer) == 0 && write_status;
+    }
+    free(bytes);
+    return write_status;
+}
+
+static int load_index(archive_index *index, const char *archive_path, const unsigned char *data, const size_t size) {
+    // Map sidecar file, which is missing unless the archive has been indexed
+    struct stat archive_stat;
+    if (stat(archive_path, &archive_stat) != 0 || (uint64_t) archive_stat.st_size != size) {
+        return 0;
+    }
+    char *index_path = make_index_path(archive_path);
+    file_mapping index_mapping;
+    const int map_status = index_path != NULL && map_file(&index_mapping, index_path, true);
+    free(index_path);
+    if (!map_status) {
+        return 0;
+    }
+
+    // Ensure the index is complete and was written for the archive as it is now
+    const unsigned char *bytes = index_mapping.data;
+    const size_t entry_count = index_mapping.size >= INDEX_HEADER_SIZE ? read_uint32(&bytes[24]) : 0;
+    if (index_mapping.size < INDEX_HEADER_SIZE || memcmp(bytes, INDEX_MAGIC, 4) != 0 || read_uint32(&bytes[4]) != INDEX_VERSION
+        || read_uint64(&bytes[8]) != size || read_uint64(&bytes[16]) != (uint64_t) archive_stat.st_mtime
+        || index_mapping.size != INDEX_HEADER_SIZE + entry_count * INDEX_RECORD_SIZE) {
+        unmap_file(&index_mapping);
+        return 0;
+    }
+
+    // Decode entries, pointing them at their data in the archive
+    archive_entry *entries = malloc(entry_count * sizeof(archive_entry));
+    uint64_t *hashes = malloc(entry_count * sizeof(uint64_t));
+    int load_status = entry_count == 0 || (entries != NULL && hashes != NULL);
+    for (size_t i = 0; i < entry_count && load_status; i++) {
+        const unsigned char *record = &bytes[INDEX_HEADER_SIZE + i * INDEX_RECORD_SIZE];
+        const uint64_t offset = read_uint64(&record[24]);
+        archive_entry *entry = &entries[i];
+        memcpy(entry->filename, record, FILENAME_SIZE);
+        entry->compression_level = record[13];
+        entry->compressed_size = read_uint32(&record[16]);
+        entry->uncompressed_size = read_uint32(&record[20]);
+        hashes[i] = read_uint64(&record[32]);
+        load_status = entry->filename[FILENAME_SIZE - 1] == '\0' && valid_filename(entry->filename) && offset <= size && entry->compressed_size <= size - offset;
+        entry->data = &data[offset];
+    }
+    unmap_file(&index_mapping);
+    if (!load_status) {
+        free(entries);
+        free(hashes);
+        return 0;
+    }
+
+    index->entries = entries;
+    index->entry_count = entry_count;
+    index->hashes = hashes;
+    index->error = NULL;
+    return 1;
+}
+
+int archive_index_open(archive_index *index, const char *archive_path, const void *data, const size_t size) {
+    // Fall back to reading headers if the sidecar is missing, stale or damaged
+    if (load_index(index, archive_path, data, size)) {
+        return 1;
+    }
+    return archive_index_build(index, data, size);
+}
+
+void archive_index_remove(const char *archive_path) {
+    char *index_path = make_index_path(archive_path);
+    if (index_path != NULL) {
+        remove(index_path);
+    }
+    free(index_path);
+}
+
+const archive_entry *archive_index_find(const archive_index *index, const char *filename) {
+    for (size_t i = index->entry_count; i-- > 0;) {
+        if (compare_filenames(index->entries[i].filename, filename) == 0) {
+            return &index->entries[i];
+        }
+    }
+    return NULL;
+}
+
+void archive_index_free(archive_index *index) {
+    free(index->entries);
+    free(index->hashes);
+    index->entries = NULL;
+    index->entry_count = 0;
+    index->hashes = NULL;
+}
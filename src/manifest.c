@@ -0,0 +1,63 @@
+/*
+ * Red Archive
+ * MIT License
+ * Copyright (c) 2020 Jacob Gelling
+ */
+
+#include "manifest.h"
+
+static void write_string(FILE *file_pointer, const char *text) {
+    // Escape quotes, backslashes and control characters, which archive paths may hold
+    fputc('"', file_pointer);
+    for (const unsigned char *character = (const unsigned char *) text; *character != '\0'; character++) {
+        if (*character == '"' || *character == '\\') {
+            fprintf(file_pointer, "\\%c", *character);
+        } else if (*character < 0x20) {
+            fprintf(file_pointer, "\\u%04x", *character);
+        } else {
+            fputc(*character, file_pointer);
+        }
+    }
+    fputc('"', file_pointer);
+}
+
+int manifest_open(manifest_writer *manifest, const char *manifest_path) {
+    manifest->archive_count = 0;
+    manifest->entry_count = 0;
+    if ((manifest->file_pointer = fopen(manifest_path, "w")) == NULL) {
+        return 0;
+    }
+    fprintf(manifest->file_pointer, "{\"archives\":[");
+    return 1;
+}
+
+void manifest_begin_archive(manifest_writer *manifest, const char *archive_path) {
+    fprintf(manifest->file_pointer, "%s\n{\"archive\":", manifest->archive_count > 0 ? "," : "");
+    write_string(manifest->file_pointer, archive_path);
+    fprintf(manifest->file_pointer, ",\"entries\":[");
+    manifest->archive_count++;
+    manifest->entry_count = 0;
+}
+
+void manifest_add(manifest_writer *manifest, const char *filename, const unsigned char compression_level, const uint32_t compressed_size, const uint32_t uncompressed_size, const uint64_t hash) {
+    fprintf(manifest->file_pointer, "%s\n{\"filename\":", manifest->entry_count > 0 ? "," : "");
+    write_string(manifest->file_pointer, filename);
+    fprintf(manifest->file_pointer, ",\"type\":%d,\"compressed_size\":%lu,\"uncompressed_size\":%lu,\"xxh64\":", compression_level,
+        (unsigned long) compressed_size, (unsigned long) uncompressed_size);
+    if (compression_level <= 6) {
+        fprintf(manifest->file_pointer, "\"%016llx\"}", (unsigned long long) hash);
+    } else {
+        fprintf(manifest->file_pointer, "null}");
+    }
+    manifest->entry_count++;
+}
+
+void manifest_end_archive(manifest_writer *manifest) {
+    fprintf(manifest->file_pointer, "]}");
+}
+
+int manifest_close(manifest_writer *manifest) {
+    fprintf(manifest->file_pointer, "]}\n");
+    const int write_status = !ferror(manifest->file_pointer);
+    return fclose(manifest->file_pointer) == 0 && write_status;
+}
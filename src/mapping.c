@@ -0,0 +1,110 @@
+/*
+ * Red Archive
+ * MIT License
+ * Copyright (c) 2020 Jacob Gelling
+ */
+
+#include "mapping.h"
+
+static int read_file(file_mapping *mapping, const char *file_path) {
+    // Open file
+    FILE *file_pointer = fopen(file_path, "rb");
+    if (file_pointer == NULL) {
+        return 0;
+    }
+
+    // Read file into memory in blocks, as its size may not be known in advance
+    unsigned char *data = NULL;
+    size_t size = 0;
+    size_t capacity = 0;
+    while (1) {
+        if (size == capacity) {
+            capacity = capacity ? capacity * 2 : 65536;
+            unsigned char *grown_data = realloc(data, capacity);
+            if (grown_data == NULL) {
+                free(data);
+                fclose(file_pointer);
+                return 0;
+            }
+            data = grown_data;
+        }
+        const size_t read_size = fread(&data[size], 1, capacity - size, file_pointer);
+        if (read_size == 0) {
+            break;
+        }
+        size += read_size;
+    }
+    const int read_status = !ferror(file_pointer);
+    fclose(file_pointer);
+    if (!read_status) {
+        free(data);
+        return 0;
+    }
+
+    mapping->data = data;
+    mapping->size = size;
+    mapping->mapped = false;
+    return 1;
+}
+
+int map_file(file_mapping *mapping, const char *file_path, const bool sequential) {
+    #ifdef _WIN32
+        HANDLE file_handle = CreateFileA(file_path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS, NULL);
+        if (file_handle == INVALID_HANDLE_VALUE) {
+            return 0;
+        }
+        LARGE_INTEGER file_size;
+        if (GetFileSizeEx(file_handle, &file_size) && file_size.QuadPart > 0 && (uint64_t) file_size.QuadPart <= SIZE_MAX) {
+            HANDLE mapping_handle = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (mapping_handle != NULL) {
+                // The view keeps the mapping alive once both handles are closed
+                const void *data = MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+                CloseHandle(mapping_handle);
+                if (data != NULL) {
+                    CloseHandle(file_handle);
+                    mapping->data = data;
+                    mapping->size = file_size.QuadPart;
+                    mapping->mapped = true;
+                    return 1;
+                }
+            }
+        }
+        CloseHandle(file_handle);
+    #else
+        const int file_descriptor = open(file_path, O_RDONLY);
+        if (file_descriptor == -1) {
+            return 0;
+        }
+        struct stat file_stat;
+        if (fstat(file_descriptor, &file_stat) == 0 && S_ISREG(file_stat.st_mode) && file_stat.st_size > 0 && (uint64_t) file_stat.st_size <= SIZE_MAX) {
+            // The mapping remains valid once the file is closed
+            void *data = mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+            if (data != MAP_FAILED) {
+                close(file_descriptor);
+                madvise(data, file_stat.st_size, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+                mapping->data = data;
+                mapping->size = file_stat.st_size;
+                mapping->mapped = true;
+                return 1;
+            }
+        }
+        close(file_descriptor);
+    #endif
+
+    // Fall back to reading empty files, pipes and anything else which cannot be mapped
+    return read_file(mapping, file_path);
+}
+
+void unmap_file(file_mapping *mapping) {
+    if (mapping->mapped) {
+        #ifdef _WIN32
+            UnmapViewOfFile(mapping->data);
+        #else
+            munmap((void *) mapping->data, mapping->size);
+        #endif
+    } else {
+        free((void *) mapping->data);
+    }
+    mapping->data = NULL;
+    mapping->size = 0;
+}
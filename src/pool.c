@@ -0,0 +1,83 @@
+/*
+ * Red Archive
+ * MIT License
+ * Copyright (c) 2020 Jacob Gelling
+ */
+
+#include "pool.h"
+
+void buffer_pool_init(buffer_pool *pool) {
+    mutex_init(&pool->mutex);
+    for (int i = 0; i < POOL_CLASS_COUNT; i++) {
+        pool->free_buffers[i] = NULL;
+    }
+    pool->allocation_count = 0;
+    pool->allocated_size = 0;
+    pool->request_count = 0;
+}
+
+int buffer_pool_reserve(buffer_pool *pool, pool_buffer *buffer, const size_t size) {
+    if (buffer->size >= size) {
+        return 1;
+    }
+    buffer_pool_release(pool, buffer);
+
+    // Find smallest size class which fits
+    int size_class = 0;
+    while (size_class < POOL_CLASS_COUNT && ((size_t) 1 << (size_class + POOL_MINIMUM_CLASS)) < size) {
+        size_class++;
+    }
+    if (size_class == POOL_CLASS_COUNT) {
+        return 0;
+    }
+    const size_t class_size = (size_t) 1 << (size_class + POOL_MINIMUM_CLASS);
+
+    // Reuse a free buffer of that class, which holds a pointer to the next free buffer, or allocate one
+    mutex_lock(&pool->mutex);
+    pool->request_count++;
+    unsigned char *data = pool->free_buffers[size_class];
+    if (data != NULL) {
+        pool->free_buffers[size_class] = *(void **) data;
+    } else if ((data = malloc(class_size)) != NULL) {
+        pool->allocation_count++;
+        pool->allocated_size += class_size;
+    }
+    mutex_unlock(&pool->mutex);
+    if (data == NULL) {
+        return 0;
+    }
+
+    buffer->data = data;
+    buffer->size = class_size;
+    return 1;
+}
+
+void buffer_pool_release(buffer_pool *pool, pool_buffer *buffer) {
+    if (buffer->data == NULL) {
+        return;
+    }
+
+    // Buffer sizes are always a size class, so find it from the size
+    int size_class = 0;
+    while (((size_t) 1 << (size_class + POOL_MINIMUM_CLASS)) < buffer->size) {
+        size_class++;
+    }
+    mutex_lock(&pool->mutex);
+    *(void **) buffer->data = pool->free_buffers[size_class];
+    pool->free_buffers[size_class] = buffer->data;
+    mutex_unlock(&pool->mutex);
+
+    buffer->data = NULL;
+    buffer->size = 0;
+}
+
+void buffer_pool_destroy(buffer_pool *pool) {
+    for (int i = 0; i < POOL_CLASS_COUNT; i++) {
+        while (pool->free_buffers[i] != NULL) {
+            void *next_buffer = *(void **) pool->free_buffers[i];
+            free(pool->free_buffers[i]);
+            pool->free_buffers[i] = next_buffer;
+        }
+    }
+    mutex_destroy(&pool->mutex);
+}
@@ -0,0 +1,85 @@
+/*
+ * Red Archive
+ * MIT License
+ * Copyright (c) 2020 Jacob Gelling
+ */
+
+#include "progress.h"
+
+// Seconds between updates of the progress line
+#define PROGRESS_INTERVAL 0.1
+
+static void print_progress(progress_report *report, const double time, const char *end) {
+    const double elapsed_time = time - report->start_time;
+    char line[128];
+    snprintf(line, sizeof(line), "%s %llu files totalling %.1f MB in %.2f seconds, %.0f files/s, %.1f MB/s", report->action,
+        (unsigned long long) report->entry_count, report->byte_count / 1e6, elapsed_time,
+        elapsed_time > 0 ? report->entry_count / elapsed_time : 0, elapsed_time > 0 ? report->byte_count / elapsed_time / 1e6 : 0);
+
+    // On a terminal, return to the start of the line and pad it to cover a longer line printed before
+    if (report->terminal) {
+        fprintf(report->file_pointer, "\r%-79s%s", line, end);
+    } else {
+        fprintf(report->file_pointer, "%s%s", line, end);
+    }
+    fflush(report->file_pointer);
+}
+
+void progress_begin(progress_report *report, FILE *file_pointer, const verbosity level, const char *action) {
+    report->file_pointer = file_pointer;
+    report->level = level;
+    report->action = action;
+    #ifdef _WIN32
+        report->terminal = _isatty(_fileno(file_pointer));
+    #else
+        report->terminal = isatty(fileno(file_pointer));
+    #endif
+    report->line_shown = false;
+    mutex_init(&report->mutex);
+    report->entry_count = 0;
+    report->byte_count = 0;
+    report->start_time = stats_wall_time();
+    report->print_time = report->start_time;
+}
+
+void progress_message(progress_report *report, const verbosity level, const char *format, ...) {
+    if (report->level < level) {
+        return;
+    }
+
+    // Start a new line if the progress line is showing, which is printed again with the next update
+    mutex_lock(&report->mutex);
+    if (report->line_shown) {
+        fputc('\n', report->file_pointer);
+        report->line_shown = false;
+    }
+    va_list arguments;
+    va_start(arguments, format);
+    vfprintf(report->file_pointer, format, arguments);
+    va_end(arguments);
+    mutex_unlock(&report->mutex);
+}
+
+void progress_advance(progress_report *report, const uint64_t byte_count) {
+    mutex_lock(&report->mutex);
+    report->entry_count++;
+    report->byte_count += byte_count;
+
+    // Only update the line on a terminal, where it is overwritten rather than filling a log
+    if (report->level == VERBOSITY_PROGRESS && report->terminal) {
+        const double time = stats_wall_time();
+        if (time - report->print_time >= PROGRESS_INTERVAL) {
+            report->print_time = time;
+            report->line_shown = true;
+            print_progress(report, time, "");
+        }
+    }
+    mutex_unlock(&report->mutex);
+}
+
+void progress_end(progress_report *report) {
+    if (report->level >= VERBOSITY_PROGRESS) {
+        print_progress(report, stats_wall_time(), "\n");
+    }
+    mutex_destroy(&report->mutex);
+}
@@ -0,0 +1,117 @@
+/*
+ * Red Archive
+ * MIT License
+ * Copyright (c) 2020 Jacob Gelling
+ */
+
+#include "reader.h"
+
+// Valid MS-DOS filename characters, which are ! $ to ) - . 0-9 @ to Z ^ to { } and ~, indexed by byte
+static const unsigned char filename_characters[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 00-0F
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 10-1F
+    0, 1, 0, 0, 1, 1, 1, 1, 1, 1, 0, 0, 0, 1, 1, 0, // 20-2F
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, // 30-3F
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 40-4F
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 1, 1, // 50-5F
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 60-6F
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1, 1, 0, // 70-7F
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 80-8F
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 90-9F
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // A0-AF
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // B0-BF
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // C0-CF
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // D0-DF
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // E0-EF
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // F0-FF
+};
+
+static inline uint32_t read_uint32(const unsigned char *bytes) {
+    // Load the little-endian value in one unaligned read where the byte order allows
+    #if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        return (uint32_t) bytes[0] | (uint32_t) bytes[1] << 8 | (uint32_t) bytes[2] << 16 | (uint32_t) bytes[3] << 24;
+    #else
+        uint32_t value;
+        memcpy(&value, bytes, sizeof(value));
+        return value;
+    #endif
+}
+
+static inline size_t filename_length(const unsigned char *data, const size_t size) {
+    // Find the null-terminator, then check every character before it without branching on each one,
+    // returning 0 if the filename is empty, unterminated or holds an invalid character
+    const unsigned char *terminator = memchr(data, '\0', size);
+    if (terminator == NULL) {
+        return 0;
+    }
+    const size_t length = terminator - data;
+    unsigned char valid = 1;
+    for (size_t i = 0; i < length; i++) {
+        valid &= filename_characters[data[i]];
+    }
+    return valid ? length : 0;
+}
+
+bool valid_filename(const char *filename) {
+    return filename_length((const unsigned char *) filename, strnlen(filename, FILENAME_SIZE - 1) + 1) > 0;
+}
+
+void archive_reader_open(archive_reader *reader, const void *data, const size_t size) {
+    reader->data = data;
+    reader->size = size;
+    reader->position = 0;
+    reader->error = NULL;
+}
+
+int archive_reader_next(archive_reader *reader, archive_entry *entry) {
+    const unsigned char *data = &reader->data[reader->position];
+    const size_t remaining = reader->size - reader->position;
+
+    // Fail if no filename left to read
+    if (remaining == 0) {
+        reader->error = "Could not read filename";
+        return -1;
+    }
+
+    // Finish reading if end of file byte found
+    if (remaining == 1 && data[0] == '\0') {
+        return 0;
+    }
+
+    // Ensure filename is valid and null-terminated
+    const size_t name_length = filename_length(data, remaining < FILENAME_SIZE ? remaining : FILENAME_SIZE);
+    if (name_length == 0) {
+        reader->error = "Invalid filename";
+        return -1;
+    }
+    memcpy(entry->filename, data, name_length + 1);
+    data += name_length + 1;
+
+    // Read compressed size, uncompressed size and compression level
+    if (remaining - name_length - 1 < HEADER_SIZE) {
+        reader->error = "Could not read entry header";
+        return -1;
+    }
+    entry->compressed_size = read_uint32(&data[0]);
+    entry->uncompressed_size = read_uint32(&data[4]);
+    entry->compression_level = data[8];
+    data += HEADER_SIZE;
+
+    // Ensure compressed data is present
+    if (remaining - name_length - 1 - HEADER_SIZE < entry->compressed_size) {
+        reader->error = "Could not read file data";
+        return -1;
+    }
+    entry->data = data;
+
+    // Move to next entry
+    reader->position += name_length + 1 + HEADER_SIZE + entry->compressed_size;
+    return 1;
+}
+
+decompress_result archive_extract(const archive_entry *entry, void *buffer, const size_t buffer_size) {
+    if (buffer_size < entry->uncompressed_size) {
+        return DECOMPRESS_SIZE_MISMATCH;
+    }
+    return decompress(entry->data, entry->compressed_size, buffer, entry->uncompressed_size, entry->compression_level);
+}
@@ -0,0 +1,210 @@
+/*
+ * Red Archive
+ * MIT License
+ * Copyright (c) 2020 Jacob Gelling
+ */
+
+#include "stats.h"
+
+static const char *phase_names[STATS_PHASE_COUNT] = {"scan", "read", "decompress", "compress", "hash", "write"};
+static const char *call_names[STATS_CALL_COUNT] = {"open", "map", "read", "write"};
+
+#ifdef _WIN32
+    static double filetime_seconds(const FILETIME kernel_time, const FILETIME user_time) {
+        // File times count 100 nanosecond intervals
+        const uint64_t kernel_ticks = (uint64_t) kernel_time.dwHighDateTime << 32 | kernel_time.dwLowDateTime;
+        const uint64_t user_ticks = (uint64_t) user_time.dwHighDateTime << 32 | user_time.dwLowDateTime;
+        return (kernel_ticks + user_ticks) / 1e7;
+    }
+#else
+    static double clock_seconds(const clockid_t clock) {
+        struct timespec time;
+        clock_gettime(clock, &time);
+        return time.tv_sec + time.tv_nsec / 1e9;
+    }
+#endif
+
+double stats_wall_time(void) {
+    #ifdef _WIN32
+        LARGE_INTEGER frequency, counter;
+        QueryPerformanceFrequency(&frequency);
+        QueryPerformanceCounter(&counter);
+        return (double) counter.QuadPart / frequency.QuadPart;
+    #else
+        return clock_seconds(CLOCK_MONOTONIC);
+    #endif
+}
+
+double stats_thread_time(void) {
+    #ifdef _WIN32
+        FILETIME creation_time, exit_time, kernel_time, user_time;
+        GetThreadTimes(GetCurrentThread(), &creation_time, &exit_time, &kernel_time, &user_time);
+        return filetime_seconds(kernel_time, user_time);
+    #else
+        return clock_seconds(CLOCK_THREAD_CPUTIME_ID);
+    #endif
+}
+
+double stats_process_time(void) {
+    #ifdef _WIN32
+        FILETIME creation_time, exit_time, kernel_time, user_time;
+        GetProcessTimes(GetCurrentProcess(), &creation_time, &exit_time, &kernel_time, &user_time);
+        return filetime_seconds(kernel_time, user_time);
+    #else
+        return clock_seconds(CLOCK_PROCESS_CPUTIME_ID);
+    #endif
+}
+
+void stats_begin(archive_stats *stats) {
+    if (stats == NULL) {
+        return;
+    }
+    memset(stats, 0, sizeof(archive_stats));
+
+    // Hold start times in the totals until the run ends
+    stats->total_wall_time = stats_wall_time();
+    stats->total_cpu_time = stats_process_time();
+}
+
+void stats_end(archive_stats *stats) {
+    if (stats == NULL) {
+        return;
+    }
+    stats->total_wall_time = stats_wall_time() - stats->total_wall_time;
+    stats->total_cpu_time = stats_process_time() - stats->total_cpu_time;
+}
+
+void stats_start(const archive_stats *stats, stats_timer *timer) {
+    if (stats == NULL) {
+        return;
+    }
+    timer->wall_time = stats_wall_time();
+    timer->cpu_time = stats_thread_time();
+}
+
+void stats_stop(archive_stats *stats, const stats_phase phase, const stats_timer *timer) {
+    if (stats == NULL) {
+        return;
+    }
+    stats->wall_time[phase] += stats_wall_time() - timer->wall_time;
+    stats->cpu_time[phase] += stats_thread_time() - timer->cpu_time;
+}
+
+void stats_entry(archive_stats *stats, const unsigned char compression_level, const uint64_t bytes_in, const uint64_t bytes_out) {
+    if (stats == NULL) {
+        return;
+    }
+    const int type = compression_level < STATS_TYPE_COUNT - 1 ? compression_level : STATS_TYPE_COUNT - 1;
+    stats->entry_count[type]++;
+    stats->bytes_in[type] += bytes_in;
+    stats->bytes_out[type] += bytes_out;
+}
+
+void stats_calls(archive_stats *stats, const stats_call call, const uint64_t count) {
+    if (stats == NULL) {
+        return;
+    }
+    stats->call_count[call] += count;
+}
+
+void stats_buffer(archive_stats *stats, const size_t size) {
+    if (stats == NULL) {
+        return;
+    }
+    if (size > stats->peak_buffer_size) {
+        stats->peak_buffer_size = size;
+    }
+}
+
+void stats_pool(archive_stats *stats, const size_t allocated_size, const size_t allocation_count, const size_t request_count) {
+    if (stats == NULL) {
+        return;
+    }
+    stats_buffer(stats, allocated_size);
+    stats->buffer_allocation_count += allocation_count;
+    stats->buffer_request_count += request_count;
+}
+
+void stats_merge(archive_stats *stats, const archive_stats *other) {
+    if (stats == NULL) {
+        return;
+    }
+    for (int i = 0; i < STATS_PHASE_COUNT; i++) {
+        stats->wall_time[i] += other->wall_time[i];
+        stats->cpu_time[i] += other->cpu_time[i];
+    }
+    for (int i = 0; i < STATS_TYPE_COUNT; i++) {
+        stats->entry_count[i] += other->entry_count[i];
+        stats->bytes_in[i] += other->bytes_in[i];
+        stats->bytes_out[i] += other->bytes_out[i];
+    }
+    for (int i = 0; i < STATS_CALL_COUNT; i++) {
+        stats->call_count[i] += other->call_count[i];
+    }
+    stats_pool(stats, other->peak_buffer_size, other->buffer_allocation_count, other->buffer_request_count);
+}
+
+static void type_name(const int type, char *name) {
+    if (type == STATS_TYPE_COUNT - 1) {
+        strcpy(name, "other");
+    } else {
+        sprintf(name, "%d", type);
+    }
+}
+
+void stats_print(const archive_stats *stats, FILE *file_pointer) {
+    fprintf(file_pointer, "%-12s %12s %12s\n", "Phase", "Wall (s)", "CPU (s)");
+    for (int i = 0; i < STATS_PHASE_COUNT; i++) {
+        fprintf(file_pointer, "%-12s %12.4f %12.4f\n", phase_names[i], stats->wall_time[i], stats->cpu_time[i]);
+    }
+    fprintf(file_pointer, "%-12s %12.4f %12.4f\n\n", "total", stats->total_wall_time, stats->total_cpu_time);
+
+    // Only list compression types which were seen
+    fprintf(file_pointer, "%-12s %12s %16s %16s\n", "Type", "Entries", "Bytes in", "Bytes out");
+    uint64_t entry_count = 0, bytes_in = 0, bytes_out = 0;
+    for (int i = 0; i < STATS_TYPE_COUNT; i++) {
+        if (stats->entry_count[i] == 0) {
+            continue;
+        }
+        char name[8];
+        type_name(i, name);
+        fprintf(file_pointer, "%-12s %12llu %16llu %16llu\n", name, (unsigned long long) stats->entry_count[i],
+            (unsigned long long) stats->bytes_in[i], (unsigned long long) stats->bytes_out[i]);
+        entry_count += stats->entry_count[i];
+        bytes_in += stats->bytes_in[i];
+        bytes_out += stats->bytes_out[i];
+    }
+    fprintf(file_pointer, "%-12s %12llu %16llu %16llu\n\n", "total", (unsigned long long) entry_count, (unsigned long long) bytes_in, (unsigned long long) bytes_out);
+
+    fprintf(file_pointer, "%-12s %12s\n", "Call", "Count");
+    for (int i = 0; i < STATS_CALL_COUNT; i++) {
+        fprintf(file_pointer, "%-12s %12llu\n", call_names[i], (unsigned long long) stats->call_count[i]);
+    }
+    fprintf(file_pointer, "\nPeak buffer memory %zu bytes\n", stats->peak_buffer_size);
+    fprintf(file_pointer, "Buffer allocations %llu for %llu requests\n", (unsigned long long) stats->buffer_allocation_count, (unsigned long long) stats->buffer_request_count);
+}
+
+void stats_print_json(const archive_stats *stats, FILE *file_pointer) {
+    fprintf(file_pointer, "{\"phases\":{");
+    for (int i = 0; i < STATS_PHASE_COUNT; i++) {
+        fprintf(file_pointer, "%s\"%s\":{\"wall\":%.6f,\"cpu\":%.6f}", i > 0 ? "," : "", phase_names[i], stats->wall_time[i], stats->cpu_time[i]);
+    }
+    fprintf(file_pointer, "},\"total\":{\"wall\":%.6f,\"cpu\":%.6f},\"types\":{", stats->total_wall_time, stats->total_cpu_time);
+    bool first = true;
+    for (int i = 0; i < STATS_TYPE_COUNT; i++) {
+        if (stats->entry_count[i] == 0) {
+            continue;
+        }
+        char name[8];
+        type_name(i, name);
+        fprintf(file_pointer, "%s\"%s\":{\"entries\":%llu,\"bytes_in\":%llu,\"bytes_out\":%llu}", first ? "" : ",", name,
+            (unsigned long long) stats->entry_count[i], (unsigned long long) stats->bytes_in[i], (unsigned long long) stats->bytes_out[i]);
+        first = false;
+    }
+    fprintf(file_pointer, "},\"calls\":{");
+    for (int i = 0; i < STATS_CALL_COUNT; i++) {
+        fprintf(file_pointer, "%s\"%s\":%llu", i > 0 ? "," : "", call_names[i], (unsigned long long) stats->call_count[i]);
+    }
+    fprintf(file_pointer, "},\"peak_buffer_bytes\":%zu,\"buffer_allocations\":%llu,\"buffer_requests\":%llu}\n", stats->peak_buffer_size,
+        (unsigned long long) stats->buffer_allocation_count, (unsigned long long) stats->buffer_request_count);
+}
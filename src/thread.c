@@ -0,0 +1,120 @@
+/*
+ * Red Archive
+ * MIT License
+ * Copyright (c) 2020 Jacob Gelling
+ */
+
+#include "thread.h"
+
+typedef struct {
+    thread_function function;
+    void *argument;
+} thread_start;
+
+#ifdef _WIN32
+    static DWORD WINAPI run_thread(LPVOID start_pointer) {
+#else
+    static void *run_thread(void *start_pointer) {
+#endif
+    // Copy function and argument before freeing them
+    const thread_start start = *(thread_start *) start_pointer;
+    free(start_pointer);
+    start.function(start.argument);
+    return 0;
+}
+
+int thread_create(thread_handle *thread, const thread_function function, void *argument) {
+    thread_start *start = malloc(sizeof(thread_start));
+    if (start == NULL) {
+        return 0;
+    }
+    start->function = function;
+    start->argument = argument;
+
+    #ifdef _WIN32
+        *thread = CreateThread(NULL, 0, run_thread, start, 0, NULL);
+        if (*thread == NULL) {
+            free(start);
+            return 0;
+        }
+    #else
+        if (pthread_create(thread, NULL, run_thread, start) != 0) {
+            free(start);
+            return 0;
+        }
+    #endif
+    return 1;
+}
+
+void thread_join(thread_handle thread) {
+    #ifdef _WIN32
+        WaitForSingleObject(thread, INFINITE);
+        CloseHandle(thread);
+    #else
+        pthread_join(thread, NULL);
+    #endif
+}
+
+void mutex_init(thread_mutex *mutex) {
+    #ifdef _WIN32
+        InitializeCriticalSection(mutex);
+    #else
+        pthread_mutex_init(mutex, NULL);
+    #endif
+}
+
+void mutex_lock(thread_mutex *mutex) {
+    #ifdef _WIN32
+        EnterCriticalSection(mutex);
+    #else
+        pthread_mutex_lock(mutex);
+    #endif
+}
+
+void mutex_unlock(thread_mutex *mutex) {
+    #ifdef _WIN32
+        LeaveCriticalSection(mutex);
+    #else
+        pthread_mutex_unlock(mutex);
+    #endif
+}
+
+void mutex_destroy(thread_mutex *mutex) {
+    #ifdef _WIN32
+        DeleteCriticalSection(mutex);
+    #else
+        pthread_mutex_destroy(mutex);
+    #endif
+}
+
+void condition_init(thread_condition *condition) {
+    #ifdef _WIN32
+        InitializeConditionVariable(condition);
+    #else
+        pthread_cond_init(condition, NULL);
+    #endif
+}
+
+void condition_wait(thread_condition *condition, thread_mutex *mutex) {
+    #ifdef _WIN32
+        SleepConditionVariableCS(condition, mutex, INFINITE);
+    #else
+        pthread_cond_wait(condition, mutex);
+    #endif
+}
+
+void condition_broadcast(thread_condition *condition) {
+    #ifdef _WIN32
+        WakeAllConditionVariable(condition);
+    #else
+        pthread_cond_broadcast(condition);
+    #endif
+}
+
+void condition_destroy(thread_condition *condition) {
+    #ifdef _WIN32
+        (void) condition;
+    #else
+        pthread_cond_destroy(condition);
+    #endif
+}
@@ -0,0 +1,85 @@
+/*
+ * Red Archive
+ * MIT License
+ * Copyright (c) 2020 Jacob Gelling
+ */
+
+#include "writer.h"
+
+static inline void write_uint32(unsigned char *bytes, const uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        bytes[i] = (value >> 8 * i) & 0xFF;
+    }
+}
+
+static int reserve(archive_writer *writer, const size_t size) {
+    // Grow buffer geometrically
+    if (writer->capacity - writer->size < size) {
+        size_t capacity = writer->capacity ? writer->capacity : 4096;
+        while (capacity - writer->size < size) {
+            capacity *= 2;
+        }
+        unsigned char *data = realloc(writer->data, capacity);
+        if (data == NULL) {
+            return 0;
+        }
+        writer->data = data;
+        writer->capacity = capacity;
+    }
+    return 1;
+}
+
+size_t write_entry_header(unsigned char *buffer, const char *filename, const uint32_t compressed_size, const uint32_t uncompressed_size, const unsigned char compression_level) {
+    const size_t filename_size = strlen(filename) + 1;
+    memcpy(buffer, filename, filename_size);
+    write_uint32(&buffer[filename_size], compressed_size);
+    write_uint32(&buffer[filename_size + 4], uncompressed_size);
+    buffer[filename_size + 8] = compression_level;
+    return filename_size + HEADER_SIZE;
+}
+
+void archive_writer_open(archive_writer *writer) {
+    writer->data = NULL;
+    writer->size = 0;
+    writer->capacity = 0;
+    writer->effort = COMPRESS_LAZY;
+}
+
+int archive_writer_add(archive_writer *writer, const char *filename, const void *data, const size_t size, const unsigned char compression_level) {
+    // Ensure entry can be represented in the archive
+    if (!valid_filename(filename) || !compress_supported(compression_level)) {
+        return 0;
+    }
+    const size_t bound = compress_bound(size, compression_level);
+    if (bound > UINT32_MAX || !reserve(writer, FILENAME_SIZE + HEADER_SIZE + bound)) {
+        return 0;
+    }
+
+    // Compress data after space for the header, then write the header in front of it
+    unsigned char *header = &writer->data[writer->size];
+    const size_t header_size = strlen(filename) + 1 + HEADER_SIZE;
+    size_t compressed_size;
+    unsigned char entry_level = compression_level;
+    const int compress_status = compression_level == COMPRESSION_AUTO
+        ? compress_auto(data, size, &header[header_size], &compressed_size, &entry_level, writer->effort)
+        : compress(data, size, &header[header_size], &compressed_size, compression_level, writer->effort);
+    if (!compress_status) {
+        return 0;
+    }
+    write_entry_header(header, filename, compressed_size, size, entry_level);
+    writer->size += header_size + compressed_size;
+    return 1;
+}
+
+int archive_writer_finish(archive_writer *writer) {
+    if (!reserve(writer, 1)) {
+        return 0;
+    }
+    writer->data[writer->size++] = '\0';
+    return 1;
+}
+
+void archive_writer_close(archive_writer *writer) {
+    free(writer->data);
+    archive_writer_open(writer);
+}